@@ -0,0 +1,68 @@
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include <stdlib.h>
+#include "catch_amalgamated.hpp"
+#include "flat_set.h"
+#include "run_set.h"
+
+using namespace std::chrono;
+using std::vector;
+
+static milliseconds now() {
+  return duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+}
+
+// Unions the ids of many small groups of consecutive markers into one set, as
+// happens on the upper nodes of a marker index full of overlapping markers,
+// then erases every id again one at a time.
+template <typename Set>
+static void benchmark_set(const char *name, const vector<vector<unsigned>> &groups) {
+  vector<Set> group_sets(groups.size());
+  for (size_t i = 0; i < groups.size(); i++) {
+    for (unsigned id : groups[i]) group_sets[i].insert(id);
+  }
+
+  milliseconds start = now();
+  Set combined;
+  for (const Set &group_set : group_sets) {
+    combined.insert(group_set);
+  }
+  milliseconds end = now();
+  std::cout << name << " union " << (end - start).count() << "\n";
+
+  start = now();
+  for (const auto &group : groups) {
+    for (unsigned id : group) combined.erase(id);
+  }
+  end = now();
+  std::cout << name << " erase " << (end - start).count() << "\n";
+  REQUIRE(combined.size() == 0);
+}
+
+template <typename T>
+struct merging_flat_set : flat_set<T> {
+  using flat_set<T>::insert;
+  void insert(const merging_flat_set &other) {
+    flat_set<T>::insert(other.begin(), other.end());
+  }
+};
+
+TEST_CASE("MarkerIdSet - flat_set vs run_set") {
+  srand(0);
+  vector<vector<unsigned>> groups;
+  unsigned next_id = 0;
+  for (unsigned i = 0; i < 2000; i++) {
+    vector<unsigned> group;
+    for (unsigned j = 0, n = 1 + rand() % 100; j < n; j++) group.push_back(next_id++);
+    groups.push_back(group);
+  }
+
+  // Shuffle the groups so that ids are not unioned in order.
+  for (size_t i = groups.size() - 1; i > 0; i--) {
+    std::swap(groups[i], groups[rand() % (i + 1)]);
+  }
+
+  benchmark_set<merging_flat_set<unsigned>>("flat_set", groups);
+  benchmark_set<run_set<unsigned>>("run_set", groups);
+}
@@ -37,3 +37,107 @@ TEST_CASE("MarkerIndex::insert") {
   milliseconds end = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
   std::cout << "Inserting " << (end - start).count();
 }
+
+TEST_CASE("MarkerIndex::insert_many") {
+  srand(0);
+  MarkerIndex marker_index;
+  vector<MarkerIndex::MarkerId> ids;
+  vector<Range> ranges;
+  uint count = 200000;
+
+  for (uint i = 0; i < count; i++) {
+    ids.push_back(i);
+    ranges.push_back(get_random_range());
+  }
+
+  milliseconds start = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+  marker_index.insert_many(ids, ranges);
+  milliseconds end = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+  std::cout << "Inserting many " << (end - start).count();
+}
+
+TEST_CASE("MarkerIndex::splice_many") {
+  srand(0);
+  MarkerIndex marker_index;
+  uint count = 20000;
+
+  for (uint i = 0; i < count; i++) {
+    Range range = get_random_range();
+    marker_index.insert(i, range.start, range.end);
+  }
+
+  vector<MarkerIndex::Splice> splices;
+  for (uint row = 0; row < 100; row++) {
+    splices.push_back({Point(row, 10), Point(), Point(0, 1)});
+  }
+
+  milliseconds start = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+  for (uint i = 0; i < 100; i++) {
+    marker_index.splice_many(splices);
+  }
+  milliseconds end = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+  std::cout << "Splicing many " << (end - start).count();
+}
+
+TEST_CASE("MarkerIndex::get_range interleaved with edits") {
+  srand(0);
+  MarkerIndex marker_index;
+  uint count = 100000;
+
+  for (uint i = 0; i < count; i++) {
+    Point start(rand() % 10000, rand() % 100);
+    marker_index.insert(i, start, start.traverse(Point(0, 1 + rand() % 10)));
+  }
+
+  milliseconds start = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+  for (uint edit = 0; edit < 1000; edit++) {
+    marker_index.splice(Point(9000 + edit, 0), Point(), Point(0, 1));
+    for (uint i = 0; i < count; i += 10) {
+      marker_index.get_range(i);
+    }
+  }
+  milliseconds end = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+  std::cout << "Getting ranges between edits " << (end - start).count();
+}
+
+TEST_CASE("MarkerIndex with 1M markers") {
+  srand(0);
+  MarkerIndex marker_index;
+  vector<Range> ranges;
+  uint count = 1000000;
+
+  for (uint i = 0; i < count; i++) {
+    Point start(rand() % 100000, rand() % 100);
+    Point end = rand() % 2 ? start : start.traverse(Point(rand() % 3, rand() % 10));
+    ranges.push_back(Range{start, end});
+  }
+
+  milliseconds start = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+  for (uint i = 0; i < count; i++) {
+    marker_index.insert(i, ranges[i].start, ranges[i].end);
+  }
+  milliseconds end = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+  std::cout << "Inserting 1M " << (end - start).count() << "\n";
+
+  start = end;
+  for (uint i = 0; i < 20000; i++) {
+    uint row = rand() % 100000;
+    marker_index.find_intersecting(Point(row, 0), Point(row + 50, 0));
+  }
+  end = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+  std::cout << "Finding intersecting in 1M " << (end - start).count() << "\n";
+
+  start = end;
+  for (uint i = 0; i < 2000000; i++) {
+    marker_index.get_range(rand() % count);
+  }
+  end = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+  std::cout << "Getting ranges in 1M " << (end - start).count() << "\n";
+
+  start = end;
+  for (uint i = 0; i < count; i += 2) {
+    marker_index.remove(i);
+  }
+  end = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+  std::cout << "Removing from 1M " << (end - start).count();
+}
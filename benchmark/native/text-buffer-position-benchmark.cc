@@ -0,0 +1,60 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include "catch_amalgamated.hpp"
+#include "text-buffer.h"
+
+using namespace std::chrono;
+using std::u16string;
+using std::vector;
+
+static milliseconds now() {
+  return duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+}
+
+static void measure_position_for_offset(TextBuffer &buffer, const char *description) {
+  vector<uint32_t> offsets;
+  for (uint32_t i = 0; i < 1000000; i++) {
+    offsets.push_back(rand() % buffer.size());
+  }
+
+  milliseconds start = now();
+  uint32_t row_sum = 0;
+  for (uint32_t offset : offsets) {
+    row_sum += buffer.position_for_offset(offset).row;
+  }
+  milliseconds end = now();
+  std::cout << "Looking up 1M offsets " << description << ": " << (end - start).count()
+            << " (" << row_sum << ")\n";
+}
+
+// Maps offsets to positions in a buffer with many scattered edits, both when
+// the edits are all in one layer on top of the base text and when they are
+// split across the layers kept alive by a snapshot.
+TEST_CASE("TextBuffer::position_for_offset - many scattered edits") {
+  srand(0);
+  u16string text;
+  while (text.size() < 1000000) {
+    for (uint32_t i = 0, n = rand() % 60; i < n; i++) {
+      text += u'a' + rand() % 26;
+    }
+    text += u'\n';
+  }
+
+  TextBuffer buffer{text};
+  TextBuffer::Snapshot *snapshot = nullptr;
+  for (uint32_t i = 0; i < 10000; i++) {
+    if (i == 5000) {
+      measure_position_for_offset(buffer, "in one layer");
+      snapshot = buffer.create_snapshot();
+    }
+    uint32_t offset = rand() % buffer.size();
+    Point position = buffer.position_for_offset(offset);
+    buffer.set_text_in_range(Range{position, position}, rand() % 3 ? u"v" : u"\n");
+  }
+
+  measure_position_for_offset(buffer, "above a snapshot");
+  delete snapshot;
+}
@@ -0,0 +1,56 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include "catch_amalgamated.hpp"
+#include "regex.h"
+#include "text-buffer.h"
+#include "text-slice.h"
+
+using namespace std::chrono;
+using std::u16string;
+using std::vector;
+
+static milliseconds now() {
+  return duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+}
+
+// Searches a buffer whose text is split into many small chunks by scattered
+// edits, so that matches often continue past the end of a chunk.
+TEST_CASE("TextBuffer::find_all - many scattered edits") {
+  srand(0);
+  const char16_t *words[] = {u"function", u"return", u"value", u"x1", u"if", u"else", u"42", u"const"};
+  u16string text;
+  while (text.size() < 1000000) {
+    for (uint32_t i = 0, n = rand() % 12; i < n; i++) {
+      text += words[rand() % 8];
+      text += u' ';
+    }
+    text += u'\n';
+  }
+
+  TextBuffer buffer{text};
+  for (uint32_t i = 0; i < 10000; i++) {
+    uint32_t offset = rand() % buffer.size();
+    Point position = buffer.position_for_offset(offset);
+    buffer.set_text_in_range(Range{position, position}, rand() % 2 ? u"v" : u" ");
+  }
+  std::cout << "Chunks: " << buffer.chunks().size() << "\n";
+
+  const char16_t *patterns[] = {u"\\w+", u"[a-z]+\\d", u"return\\s+value", u"e\\s*l\\s*s\\s*e"};
+  for (const char16_t *pattern : patterns) {
+    u16string error_message;
+    Regex regex(pattern, &error_message);
+    REQUIRE(error_message.empty());
+
+    milliseconds start = now();
+    size_t match_count = 0;
+    for (uint32_t i = 0; i < 5; i++) {
+      match_count += buffer.find_all(regex).size();
+    }
+    milliseconds end = now();
+    std::cout << "Finding all " << std::string(pattern, pattern + std::char_traits<char16_t>::length(pattern))
+              << ": " << (end - start).count() << " (" << match_count / 5 << " matches)\n";
+  }
+}
@@ -7,8 +7,10 @@
             ],
             "sources": [
                 "src/bindings/bindings.cc",
+                "src/bindings/live-search-wrapper.cc",
                 "src/bindings/marker-index-wrapper.cc",
                 "src/bindings/patch-wrapper.cc",
+                "src/bindings/patch-history-wrapper.cc",
                 "src/bindings/point-wrapper.cc",
                 "src/bindings/range-wrapper.cc",
                 "src/bindings/text-buffer-wrapper.cc",
@@ -16,6 +18,7 @@
                 "src/bindings/text-reader.cc",
                 "src/bindings/string-conversion.cc",
                 "src/bindings/text-writer.cc",
+                "src/bindings/word-corpus-wrapper.cc",
             ],
             "include_dirs": [
                 "src/core",
@@ -62,8 +65,10 @@
             ],
             "sources": [
                 "src/core/encoding-conversion.cc",
+                "src/core/live-search.cc",
                 "src/core/marker-index.cc",
                 "src/core/patch.cc",
+                "src/core/patch-history.cc",
                 "src/core/point.cc",
                 "src/core/range.cc",
                 "src/core/regex.cc",
@@ -72,6 +77,8 @@
                 "src/core/text-slice.cc",
                 "src/core/text-diff.cc",
                 "src/core/libmba-diff.cc",
+                "src/core/word-corpus.cc",
+                "src/core/word-index.cc",
             ],
             "include_dirs": [
                 "vendor/libcxx"
@@ -165,10 +172,16 @@
                     "test/native/test-helpers.cc",
                     "test/native/tests.cc",
                     "test/native/encoding-conversion-test.cc",
+                    "test/native/live-search-test.cc",
+                    "test/native/marker-index-test.cc",
+                    "test/native/marker-index-snapshot-test.cc",
                     "test/native/patch-test.cc",
+                    "test/native/patch-history-test.cc",
+                    "test/native/run-set-test.cc",
                     "test/native/text-buffer-test.cc",
                     "test/native/text-test.cc",
                     "test/native/text-diff-test.cc",
+                    "test/native/word-corpus-test.cc",
                     "vendor/catch_amalgamated.cpp"
                 ],
                 "include_dirs": [
@@ -4,8 +4,9 @@ if (process.env.SUPERSTRING_USE_BROWSER_VERSION) {
   binding = require('./browser');
 
   const {TextBuffer, Patch} = binding
-  const {findSync, findAllSync, findAndMarkAllSync, findWordsWithSubsequenceInRange, getCharacterAtPosition} = TextBuffer.prototype
+  const {findSync, findAllSync, findAllMultiSync, findAndMarkAllSync, findWordsWithSubsequenceInRange, getCharacterAtPosition} = TextBuffer.prototype
   const DEFAULT_RANGE = Object.freeze({start: {row: 0, column: 0}, end: {row: Infinity, column: Infinity}})
+  const SEARCH_BATCH_SIZE = 10000
 
   TextBuffer.prototype.findInRangeSync = function (pattern, range) {
     let ignoreCase = false
@@ -46,6 +47,28 @@ if (process.env.SUPERSTRING_USE_BROWSER_VERSION) {
     return this.findAllInRangeSync(pattern, DEFAULT_RANGE)
   }
 
+  TextBuffer.prototype.findAllMultiInRangeSync = function (patterns, range) {
+    let unicode = false
+    patterns = patterns.map(pattern => {
+      if (pattern.source) {
+        if (pattern.unicode) unicode = true
+        return {source: pattern.source, isLiteral: false, ignoreCase: pattern.flags.includes('i')}
+      } else {
+        return {source: pattern, isLiteral: true, ignoreCase: false}
+      }
+    })
+    const result = findAllMultiSync.call(this, patterns, unicode, range)
+    if (typeof result === 'string') {
+      throw new Error(result);
+    } else {
+      return result
+    }
+  }
+
+  TextBuffer.prototype.findAllMultiSync = function (patterns) {
+    return this.findAllMultiInRangeSync(patterns, DEFAULT_RANGE)
+  }
+
   TextBuffer.prototype.findAndMarkAllInRangeSync = function (markerIndex, nextId, exclusive, pattern, range) {
     let ignoreCase = false
     let unicode = false
@@ -82,16 +105,57 @@ if (process.env.SUPERSTRING_USE_BROWSER_VERSION) {
     return new Promise(resolve => resolve(this.findAllInRangeSync(pattern, range)))
   }
 
+  TextBuffer.prototype.findAllInBatches = function (pattern, options, batchCallback) {
+    if (typeof options !== 'object') {
+      batchCallback = options
+      options = {}
+    }
+
+    return new Promise(resolve => {
+      const ranges = this.findAllInRangeSync(pattern, options.range || DEFAULT_RANGE)
+      let parts = [ranges]
+      if (options.priorityRange) {
+        const startRow = options.priorityRange.start.row
+        const endRow = options.priorityRange.end.row
+        parts = [
+          ranges.filter(range => range.start.row >= startRow && range.start.row <= endRow),
+          ranges.filter(range => range.start.row > endRow),
+          ranges.filter(range => range.start.row < startRow)
+        ]
+      }
+
+      let remainingCount = options.maxCount == null ? Infinity : options.maxCount
+      let reportedMatchCount = 0
+      for (const part of parts) {
+        for (let i = 0; i < part.length && remainingCount > 0; i += SEARCH_BATCH_SIZE) {
+          const batch = part.slice(i, i + Math.min(SEARCH_BATCH_SIZE, remainingCount))
+          remainingCount -= batch.length
+          reportedMatchCount += batch.length
+          if (batchCallback(batch) === false) return resolve(reportedMatchCount)
+        }
+      }
+      resolve(reportedMatchCount)
+    })
+  }
+
+  TextBuffer.prototype.findAllMulti = function (patterns) {
+    return new Promise(resolve => resolve(this.findAllMultiSync(patterns)))
+  }
+
+  TextBuffer.prototype.findAllMultiInRange = function (patterns, range) {
+    return new Promise(resolve => resolve(this.findAllMultiInRangeSync(patterns, range)))
+  }
+
   TextBuffer.prototype.findWordsWithSubsequence = function (query, extraWordCharacters, maxCount) {
     const range = {start: {row: 0, column: 0}, end: this.getExtent()}
     return Promise.resolve(
-      findWordsWithSubsequenceInRange.call(this, query, extraWordCharacters, range).slice(0, maxCount)
+      findWordsWithSubsequenceInRange.call(this, query, extraWordCharacters, range, maxCount)
     )
   }
 
   TextBuffer.prototype.findWordsWithSubsequenceInRange = function (query, extraWordCharacters, maxCount, range) {
     return Promise.resolve(
-      findWordsWithSubsequenceInRange.call(this, query, extraWordCharacters, range).slice(0, maxCount)
+      findWordsWithSubsequenceInRange.call(this, query, extraWordCharacters, range, maxCount)
     )
   }
 
@@ -126,8 +190,8 @@ if (process.env.SUPERSTRING_USE_BROWSER_VERSION) {
 
   const {TextBuffer, TextWriter, TextReader} = binding
   const {
-    load, save, baseTextMatchesFile,
-    find, findAll, findSync, findAllSync, findWordsWithSubsequenceInRange
+    load, save, baseTextMatchesFile, serializeChangesToFile,
+    find, findAll, findSync, findAllSync, findAllInBatches, findAllMulti, findAllMultiSync, findWordsWithSubsequenceInRange
   } = TextBuffer.prototype
 
   TextBuffer.prototype.load = function (source, options, progressCallback) {
@@ -215,6 +279,14 @@ if (process.env.SUPERSTRING_USE_BROWSER_VERSION) {
     })
   }
 
+  TextBuffer.prototype.serializeChangesToFile = function (filePath) {
+    return new Promise((resolve, reject) => {
+      serializeChangesToFile.call(this, filePath, (error) => {
+        error ? reject(error) : resolve()
+      })
+    })
+  }
+
   TextBuffer.prototype.find = function (pattern) {
     return this.findInRange(pattern, null)
   }
@@ -256,6 +328,42 @@ if (process.env.SUPERSTRING_USE_BROWSER_VERSION) {
     return interpretRangeArray(findAllSync.call(this, pattern, range))
   }
 
+  TextBuffer.prototype.findAllInBatches = function (pattern, options, batchCallback) {
+    if (typeof options !== 'object') {
+      batchCallback = options
+      options = {}
+    }
+
+    const maxCount = Number.isFinite(options.maxCount) ? options.maxCount : null
+    return new Promise((resolve, reject) => {
+      findAllInBatches.call(this, pattern, options.range || null, maxCount, options.priorityRange || null, (rawData) => {
+        return batchCallback(interpretRangeArray(rawData))
+      }, (error, matchCount) => {
+        error ? reject(error) : resolve(matchCount)
+      })
+    })
+  }
+
+  TextBuffer.prototype.findAllMulti = function (patterns) {
+    return this.findAllMultiInRange(patterns, null)
+  }
+
+  TextBuffer.prototype.findAllMultiInRange = function (patterns, range) {
+    return new Promise((resolve, reject) => {
+      findAllMulti.call(this, patterns, (error, result) => {
+        error ? reject(error) : resolve(interpretPatternMatchArray(result))
+      }, range)
+    })
+  }
+
+  TextBuffer.prototype.findAllMultiSync = function (patterns) {
+    return interpretPatternMatchArray(findAllMultiSync.call(this, patterns, null))
+  }
+
+  TextBuffer.prototype.findAllMultiInRangeSync = function (patterns, range) {
+    return interpretPatternMatchArray(findAllMultiSync.call(this, patterns, range))
+  }
+
   TextBuffer.prototype.findWordsWithSubsequence = function (query, extraWordCharacters, maxCount) {
     return this.findWordsWithSubsequenceInRange(query, extraWordCharacters, maxCount, {
       start: {row: 0, column: 0},
@@ -282,6 +390,15 @@ if (process.env.SUPERSTRING_USE_BROWSER_VERSION) {
     )
   }
 
+  const {WordCorpus} = binding
+  const {findWordsWithSubsequence: findCorpusWordsWithSubsequence} = WordCorpus.prototype
+
+  WordCorpus.prototype.findWordsWithSubsequence = function (query, extraWordCharacters, maxCount) {
+    return new Promise(resolve =>
+      findCorpusWordsWithSubsequence.call(this, query, extraWordCharacters, maxCount, resolve)
+    )
+  }
+
   TextBuffer.prototype.baseTextMatchesFile = function (source, encoding = 'UTF8') {
     encoding = normalizeEncoding(encoding)
 
@@ -328,6 +445,20 @@ if (process.env.SUPERSTRING_USE_BROWSER_VERSION) {
     return ranges
   }
 
+  function interpretPatternMatchArray (rawData) {
+    const matchCount = rawData.length / 5
+    const matches = new Array(matchCount)
+    let rawIndex = 0
+    for (let matchIndex = 0; matchIndex < matchCount; matchIndex++) {
+      matches[matchIndex] = {
+        patternIndex: rawData[rawIndex],
+        range: interpretRange(rawData, rawIndex + 1)
+      }
+      rawIndex += 5
+    }
+    return matches
+  }
+
   function interpretRange (rawData, index = 0) {
     return {
       start: {
@@ -353,5 +484,8 @@ function normalizeEncoding(encoding) {
 module.exports = {
   TextBuffer: binding.TextBuffer,
   Patch: binding.Patch,
+  PatchHistory: binding.PatchHistory,
   MarkerIndex: binding.MarkerIndex,
+  WordCorpus: binding.WordCorpus,
+  LiveSearch: binding.LiveSearch,
 }
@@ -7,13 +7,20 @@ class AddonData final {
 public:
   explicit AddonData(Napi::Env _env) {}
 
+  // LiveSearchWrapper
+  Napi::FunctionReference live_search_wrapper_constructor;
+
   // MarkerIndexWrapper
   Napi::FunctionReference marker_index_wrapper_constructor;
+  Napi::FunctionReference boundary_cursor_wrapper_constructor;
 
   // PatchWrapper
   Napi::FunctionReference patch_wrapper_constructor;
   Napi::FunctionReference change_wrapper_constructor;
 
+  // PatchHistoryWrapper
+  Napi::FunctionReference patch_history_wrapper_constructor;
+
   // TextBufferSnapshotWrapper
   Napi::FunctionReference text_buffer_snapshot_wrapper_constructor;
 
@@ -27,6 +34,9 @@ public:
 
   // TextWriter
   Napi::FunctionReference text_writer_constructor;
+
+  // WordCorpusWrapper
+  Napi::FunctionReference word_corpus_wrapper_constructor;
 };
 
 #endif // SUPERSTRING_ADDON_DATA_H_
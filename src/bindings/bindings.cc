@@ -1,11 +1,14 @@
 #include "addon-data.h"
+#include "live-search-wrapper.h"
 #include "marker-index-wrapper.h"
 #include "patch-wrapper.h"
+#include "patch-history-wrapper.h"
 #include "range-wrapper.h"
 #include "text-writer.h"
 #include "text-reader.h"
 #include "text-buffer-wrapper.h"
 #include "text-buffer-snapshot-wrapper.h"
+#include "word-corpus-wrapper.h"
 
 using namespace Napi;
 
@@ -14,11 +17,14 @@ Object Init(Env env, Object exports) {
   env.SetInstanceData(data);
 
   PatchWrapper::init(env, exports);
+  PatchHistoryWrapper::init(env, exports);
   MarkerIndexWrapper::init(env, exports);
   TextBufferWrapper::init(env, exports);
   TextWriter::init(env, exports);
   TextReader::init(env, exports);
   TextBufferSnapshotWrapper::init(env);
+  WordCorpusWrapper::init(env, exports);
+  LiveSearchWrapper::init(env, exports);
   return exports;
 }
 
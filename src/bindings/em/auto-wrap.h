@@ -9,6 +9,7 @@
 #include "marker-index.h"
 #include "optional.h"
 #include "point.h"
+#include "run_set.h"
 #include "text.h"
 
 /********** **********/
@@ -132,6 +133,21 @@ struct em_wrap_type<flat_set<ValueType>> : public em_wrap_type_base<flat_set<Val
   }
 };
 
+template <typename ValueType>
+struct em_wrap_type<run_set<ValueType>> : public em_wrap_type_base<run_set<ValueType>, emscripten::val> {
+  static run_set<ValueType> receive(emscripten::val const & val) {
+    throw std::runtime_error("Unimplemented");
+  }
+
+  static emscripten::val transmit(run_set<ValueType> const & set) {
+    auto object = emscripten::val::global("Set").new_();
+    for (auto const &element : set) {
+      object.call<void>("add", em_transmit(element));
+    }
+    return object;
+  }
+};
+
 template <>
 struct em_wrap_type<MarkerIndex::Boundary> : public em_wrap_type_base<MarkerIndex::Boundary, emscripten::val> {
   static MarkerIndex::Boundary receive(emscripten::val const &value) {
@@ -9,6 +9,9 @@ EMSCRIPTEN_BINDINGS(MarkerIndex) {
     .function("generateRandomNumber", WRAP(&MarkerIndex::generate_random_number))
     .function("insert", WRAP(&MarkerIndex::insert))
     .function("setExclusive", WRAP(&MarkerIndex::set_exclusive))
+    .function("setLayer", WRAP(&MarkerIndex::set_layer))
+    .function("getLayer", WRAP(&MarkerIndex::get_layer))
+    .function("filterByLayers", WRAP(&MarkerIndex::filter_by_layers))
     .function("remove", WRAP(&MarkerIndex::remove))
     .function("splice", WRAP(&MarkerIndex::splice))
     .function("has", WRAP(&MarkerIndex::has))
@@ -24,6 +27,8 @@ EMSCRIPTEN_BINDINGS(MarkerIndex) {
     .function("findEndingIn", WRAP(&MarkerIndex::find_ending_in))
     .function("findEndingAt", WRAP(&MarkerIndex::find_ending_at))
     .function("findBoundariesAfter", WRAP(&MarkerIndex::find_boundaries_after))
+    .function("findNextStartingAfter", WRAP(&MarkerIndex::find_next_starting_after))
+    .function("findPreviousEndingBefore", WRAP(&MarkerIndex::find_previous_ending_before))
     .function("dump", WRAP(&MarkerIndex::dump));
 
   emscripten::value_object<MarkerIndex::SpliceResult>("SpliceResult")
@@ -37,6 +37,27 @@ static emscripten::val find_all_sync(TextBuffer &buffer, std::wstring js_pattern
   return em_transmit(buffer.find_all(regex, range));
 }
 
+static emscripten::val find_all_multi_sync(TextBuffer &buffer, emscripten::val js_patterns, bool unicode, Range range) {
+  std::vector<Regex::Pattern> patterns;
+  for (unsigned i = 0, length = js_patterns["length"].as<unsigned>(); i < length; i++) {
+    emscripten::val js_pattern = js_patterns[i];
+    std::wstring source = js_pattern["source"].as<std::wstring>();
+    patterns.push_back({
+      u16string(source.begin(), source.end()),
+      js_pattern["isLiteral"].as<bool>(),
+      js_pattern["ignoreCase"].as<bool>()
+    });
+  }
+
+  u16string error_message;
+  Regex regex(patterns, &error_message, unicode);
+  if (!error_message.empty()) {
+    return emscripten::val(string(error_message.begin(), error_message.end()));
+  }
+
+  return em_transmit(buffer.find_all_multi(regex, range));
+}
+
 static emscripten::val find_and_mark_all_sync(TextBuffer &buffer, MarkerIndex &index, unsigned next_id,
                                               bool exclusive, std::wstring js_pattern, bool ignore_case, bool unicode,
                                               Range range) {
@@ -98,6 +119,7 @@ EMSCRIPTEN_BINDINGS(TextBuffer) {
     .function("isModified", WRAP_OVERLOAD(&TextBuffer::is_modified, bool (TextBuffer::*)() const))
     .function("findSync", find_sync)
     .function("findAllSync", find_all_sync)
+    .function("findAllMultiSync", find_all_multi_sync)
     .function("findAndMarkAllSync", find_and_mark_all_sync)
     .function("findWordsWithSubsequenceInRange", WRAP(&TextBuffer::find_words_with_subsequence_in_range));
 
@@ -106,4 +128,8 @@ EMSCRIPTEN_BINDINGS(TextBuffer) {
     .field("positions", WRAP_FIELD(TextBuffer::SubsequenceMatch, positions))
     .field("matchIndices", WRAP_FIELD(TextBuffer::SubsequenceMatch, match_indices))
     .field("score", WRAP_FIELD(TextBuffer::SubsequenceMatch, score));
+
+  emscripten::value_object<TextBuffer::PatternMatch>("PatternMatch")
+    .field("patternIndex", WRAP_FIELD(TextBuffer::PatternMatch, pattern_index))
+    .field("range", WRAP_FIELD(TextBuffer::PatternMatch, range));
 }
@@ -0,0 +1,94 @@
+#include "addon-data.h"
+#include "live-search-wrapper.h"
+#include "number-conversion.h"
+#include "point-wrapper.h"
+#include "range-wrapper.h"
+#include "text-buffer-wrapper.h"
+
+using namespace Napi;
+using std::move;
+using std::vector;
+
+void LiveSearchWrapper::init(Napi::Env env, Object exports) {
+  auto *data = env.GetInstanceData<AddonData>();
+
+  Napi::Function func = DefineClass(env, "LiveSearch", {
+    InstanceMethod<&LiveSearchWrapper::get_matches>("getMatches", napi_default_method),
+    InstanceMethod<&LiveSearchWrapper::get_match_count>("getMatchCount", napi_default_method),
+    InstanceMethod<&LiveSearchWrapper::splice>("splice", napi_default_method),
+  });
+
+  data->live_search_wrapper_constructor = Napi::Persistent(func);
+  exports.Set("LiveSearch", func);
+}
+
+static Napi::Value match_to_js(Napi::Env env, const LiveSearch::Match &match) {
+  Object js_match = Object::New(env);
+  js_match.Set("id", Number::New(env, match.id));
+  js_match.Set("range", RangeWrapper::from_range(env, match.range));
+  return js_match;
+}
+
+// Takes the buffer to search, a RegExp or the source of one, and the number of
+// rows before and after an edit that may hold matches that it changes.
+LiveSearchWrapper::LiveSearchWrapper(const CallbackInfo &info): ObjectWrap<LiveSearchWrapper>(info) {
+  auto env = info.Env();
+  auto *data = env.GetInstanceData<AddonData>();
+  if (!info[0].IsObject() || !info[0].As<Object>().InstanceOf(data->text_buffer_wrapper_constructor.Value())) {
+    Napi::Error::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+    return;
+  }
+
+  std::unique_ptr<Regex> regex = TextBufferWrapper::new_regex_from_js(info[1]);
+  if (!regex) return;
+
+  auto lookbehind_rows = number_conversion::number_from_js<uint32_t>(info[2]);
+  auto lookahead_rows = number_conversion::number_from_js<uint32_t>(info[3]);
+
+  Object js_buffer = info[0].As<Object>();
+  this->js_buffer = Napi::Persistent(js_buffer);
+  live_search.reset(new LiveSearch(
+    TextBufferWrapper::Unwrap(js_buffer)->text_buffer,
+    move(*regex),
+    lookbehind_rows ? *lookbehind_rows : 0,
+    lookahead_rows ? *lookahead_rows : 0
+  ));
+}
+
+Napi::Value LiveSearchWrapper::get_matches(const CallbackInfo &info) {
+  auto env = info.Env();
+  vector<LiveSearch::Match> matches = live_search->matches();
+  Array js_matches = Array::New(env, matches.size());
+  for (size_t i = 0; i < matches.size(); i++) {
+    js_matches[i] = match_to_js(env, matches[i]);
+  }
+  return js_matches;
+}
+
+Napi::Value LiveSearchWrapper::get_match_count(const CallbackInfo &info) {
+  return Number::New(info.Env(), live_search->match_count());
+}
+
+Napi::Value LiveSearchWrapper::splice(const CallbackInfo &info) {
+  auto env = info.Env();
+  optional<Point> start = PointWrapper::point_from_js(info[0]);
+  optional<Point> deleted_extent = PointWrapper::point_from_js(info[1]);
+  optional<Point> inserted_extent = PointWrapper::point_from_js(info[2]);
+  if (!start || !deleted_extent || !inserted_extent) return env.Undefined();
+
+  LiveSearch::Changes changes = live_search->splice(*start, *deleted_extent, *inserted_extent);
+
+  Array js_removed = Array::New(env, changes.removed.size());
+  for (size_t i = 0; i < changes.removed.size(); i++) {
+    js_removed[i] = Number::New(env, changes.removed[i]);
+  }
+  Array js_added = Array::New(env, changes.added.size());
+  for (size_t i = 0; i < changes.added.size(); i++) {
+    js_added[i] = match_to_js(env, changes.added[i]);
+  }
+
+  Object js_changes = Object::New(env);
+  js_changes.Set("removed", js_removed);
+  js_changes.Set("added", js_added);
+  return js_changes;
+}
@@ -0,0 +1,24 @@
+#ifndef SUPERSTRING_LIVE_SEARCH_WRAPPER_H
+#define SUPERSTRING_LIVE_SEARCH_WRAPPER_H
+
+#include <memory>
+
+#include "napi.h"
+#include "live-search.h"
+
+class LiveSearchWrapper : public Napi::ObjectWrap<LiveSearchWrapper> {
+public:
+  static void init(Napi::Env env, Napi::Object exports);
+
+  explicit LiveSearchWrapper(const Napi::CallbackInfo &info);
+
+private:
+  Napi::Value get_matches(const Napi::CallbackInfo &info);
+  Napi::Value get_match_count(const Napi::CallbackInfo &info);
+  Napi::Value splice(const Napi::CallbackInfo &info);
+
+  std::unique_ptr<LiveSearch> live_search;
+  Napi::ObjectReference js_buffer;
+};
+
+#endif // SUPERSTRING_LIVE_SEARCH_WRAPPER_H
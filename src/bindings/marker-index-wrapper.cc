@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cstring>
 #include <unordered_map>
 
 #include "v8.h"
@@ -12,29 +14,116 @@
 
 using namespace Napi;
 using std::unordered_map;
+using std::vector;
+
+// Values are copied to and from Uint32Arrays with memcpy, so their layouts
+// must be runs of uint32s.
+static_assert(sizeof(Point) == 2 * sizeof(uint32_t), "Points must be copyable as row, column pairs");
+static_assert(sizeof(Range) == 4 * sizeof(uint32_t), "Ranges must be copyable as two points");
+static_assert(sizeof(MarkerIndex::Splice) == 6 * sizeof(uint32_t), "Splices must be copyable as three points");
+static_assert(sizeof(MarkerIndex::MarkerId) == sizeof(uint32_t), "Marker ids must be copyable as uint32s");
+
+class BoundaryCursorWrapper : public ObjectWrap<BoundaryCursorWrapper> {
+ public:
+  static void init(Napi::Env env) {
+    auto *data = env.GetInstanceData<AddonData>();
+    Function func = DefineClass(env, "BoundaryCursor", {
+      InstanceMethod<&BoundaryCursorWrapper::seek>("seek"),
+      InstanceMethod<&BoundaryCursorWrapper::next>("next"),
+    });
+
+    data->boundary_cursor_wrapper_constructor = Napi::Persistent(func);
+  }
+
+  static Napi::Value new_instance(Napi::Env env, Object js_marker_index, MarkerIndex *marker_index) {
+    auto *data = env.GetInstanceData<AddonData>();
+    auto wrapper = External<MarkerIndex>::New(env, marker_index);
+    return data->boundary_cursor_wrapper_constructor.New({js_marker_index, wrapper});
+  }
+
+  BoundaryCursorWrapper(const CallbackInfo &info): ObjectWrap<BoundaryCursorWrapper>(info) {
+    if (info[0].IsObject() && info[1].IsExternal()) {
+      js_marker_index.Reset(info[0].As<Object>(), 1);
+      cursor.reset(new MarkerIndex::BoundaryCursor(info[1].As<External<MarkerIndex>>().Data()));
+    }
+  }
+
+ private:
+  Napi::Value seek(const CallbackInfo &info) {
+    auto env = info.Env();
+    optional<Point> start = PointWrapper::point_from_js(info[0]);
+    if (!start || !cursor) return env.Undefined();
+
+    vector<MarkerIndex::MarkerId> containing_start = cursor->seek(*start);
+    Uint32Array js_containing_start = Uint32Array::New(env, containing_start.size());
+    std::memcpy(js_containing_start.Data(), containing_start.data(), containing_start.size() * sizeof(MarkerIndex::MarkerId));
+    return js_containing_start;
+  }
+
+  // Returns the next `maxCount` boundaries as three Uint32Arrays: a row and
+  // column for each position, the number of markers starting and ending at
+  // each position, and the ids of those markers, starting ids first.
+  Napi::Value next(const CallbackInfo &info) {
+    auto env = info.Env();
+    if (!info[0].IsNumber() || !cursor) return env.Undefined();
+
+    MarkerIndex::PackedBoundaries boundaries;
+    cursor->next(info[0].As<Number>().Uint32Value(), &boundaries);
+
+    Uint32Array js_positions = Uint32Array::New(env, boundaries.positions.size() * 2);
+    Uint32Array js_id_counts = Uint32Array::New(env, boundaries.id_counts.size());
+    Uint32Array js_ids = Uint32Array::New(env, boundaries.ids.size());
+    std::memcpy(js_positions.Data(), boundaries.positions.data(), boundaries.positions.size() * sizeof(Point));
+    std::memcpy(js_id_counts.Data(), boundaries.id_counts.data(), boundaries.id_counts.size() * sizeof(uint32_t));
+    std::memcpy(js_ids.Data(), boundaries.ids.data(), boundaries.ids.size() * sizeof(MarkerIndex::MarkerId));
+
+    Object result = Object::New(env);
+    result.Set("positions", js_positions);
+    result.Set("idCounts", js_id_counts);
+    result.Set("ids", js_ids);
+    return result;
+  }
+
+  Napi::ObjectReference js_marker_index;
+  std::unique_ptr<MarkerIndex::BoundaryCursor> cursor;
+};
 
 void MarkerIndexWrapper::init(Napi::Env env, Object exports) {
   auto *data = env.GetInstanceData<AddonData>();
+  BoundaryCursorWrapper::init(env);
+
   Napi::Function func = DefineClass(env, "MarkerIndex", {
     InstanceMethod("generateRandomNumber", &MarkerIndexWrapper::generate_random_number),
     InstanceMethod("insert", &MarkerIndexWrapper::insert),
+    InstanceMethod("insertMany", &MarkerIndexWrapper::insert_many),
     InstanceMethod("setExclusive", &MarkerIndexWrapper::set_exclusive),
+    InstanceMethod("setLayer", &MarkerIndexWrapper::set_layer),
+    InstanceMethod("getLayer", &MarkerIndexWrapper::get_layer),
     InstanceMethod("remove", &MarkerIndexWrapper::remove),
     InstanceMethod("has", &MarkerIndexWrapper::has),
     InstanceMethod("splice", &MarkerIndexWrapper::splice),
+    InstanceMethod("spliceMany", &MarkerIndexWrapper::splice_many),
+    InstanceMethod("splicePacked", &MarkerIndexWrapper::splice_packed),
     InstanceMethod("getStart", &MarkerIndexWrapper::get_start),
     InstanceMethod("getEnd", &MarkerIndexWrapper::get_end),
     InstanceMethod("getRange", &MarkerIndexWrapper::get_range),
     InstanceMethod("compare", &MarkerIndexWrapper::compare),
     InstanceMethod("findIntersecting", &MarkerIndexWrapper::find_intersecting),
+    InstanceMethod("findIntersectingPacked", &MarkerIndexWrapper::find_intersecting_packed),
     InstanceMethod("findContaining", &MarkerIndexWrapper::find_containing),
     InstanceMethod("findContainedIn", &MarkerIndexWrapper::find_contained_in),
+    InstanceMethod("findContainedInPacked", &MarkerIndexWrapper::find_contained_in_packed),
     InstanceMethod("findStartingIn", &MarkerIndexWrapper::find_starting_in),
+    InstanceMethod("findStartingInPacked", &MarkerIndexWrapper::find_starting_in_packed),
     InstanceMethod("findStartingAt", &MarkerIndexWrapper::find_starting_at),
     InstanceMethod("findEndingIn", &MarkerIndexWrapper::find_ending_in),
     InstanceMethod("findEndingAt", &MarkerIndexWrapper::find_ending_at),
     InstanceMethod("findBoundariesAfter", &MarkerIndexWrapper::find_boundaries_after),
+    InstanceMethod("findNextStartingAfter", &MarkerIndexWrapper::find_next_starting_after),
+    InstanceMethod("findPreviousEndingBefore", &MarkerIndexWrapper::find_previous_ending_before),
+    InstanceMethod("createBoundaryCursor", &MarkerIndexWrapper::create_boundary_cursor),
     InstanceMethod("dump", &MarkerIndexWrapper::dump),
+    InstanceMethod("dumpPacked", &MarkerIndexWrapper::dump_packed),
   });
 
   data->marker_index_wrapper_constructor = Napi::Persistent(func);
@@ -72,6 +161,14 @@ Napi::Value MarkerIndexWrapper::marker_ids_set_to_js(const MarkerIndex::MarkerId
   return Napi::Value(Env(), JsValueFromV8LocalValue(js_set));
 }
 
+// Building a Set costs a JS call per id. Typed arrays are filled directly,
+// which matters for queries that match thousands of markers.
+Uint32Array MarkerIndexWrapper::marker_ids_set_to_packed_js(const MarkerIndex::MarkerIdSet &marker_ids) {
+  Uint32Array js_array = Uint32Array::New(Env(), marker_ids.size());
+  marker_ids.copy_to(js_array.Data());
+  return js_array;
+}
+
 Array MarkerIndexWrapper::marker_ids_vector_to_js(const std::vector<MarkerIndex::MarkerId> &marker_ids) {
   Array js_array = Array::New(Env(), marker_ids.size());
 
@@ -81,6 +178,24 @@ Array MarkerIndexWrapper::marker_ids_vector_to_js(const std::vector<MarkerIndex:
   return js_array;
 }
 
+Object MarkerIndexWrapper::splice_result_to_js(const MarkerIndex::SpliceResult &result) {
+  Object invalidated = Object::New(Env());
+  invalidated.Set("touch", marker_ids_set_to_js(result.touch));
+  invalidated.Set("inside", marker_ids_set_to_js(result.inside));
+  invalidated.Set("overlap", marker_ids_set_to_js(result.overlap));
+  invalidated.Set("surround", marker_ids_set_to_js(result.surround));
+  return invalidated;
+}
+
+Object MarkerIndexWrapper::splice_result_to_packed_js(const MarkerIndex::SpliceResult &result) {
+  Object invalidated = Object::New(Env());
+  invalidated.Set("touch", marker_ids_set_to_packed_js(result.touch));
+  invalidated.Set("inside", marker_ids_set_to_packed_js(result.inside));
+  invalidated.Set("overlap", marker_ids_set_to_packed_js(result.overlap));
+  invalidated.Set("surround", marker_ids_set_to_packed_js(result.surround));
+  return invalidated;
+}
+
 Object MarkerIndexWrapper::snapshot_to_js(const unordered_map<MarkerIndex::MarkerId, Range> &snapshot) {
   auto env = Env();
   Object result_object = Object::New(env);
@@ -133,6 +248,44 @@ void MarkerIndexWrapper::insert(const CallbackInfo &info) {
   this->marker_index->insert(*id, *start, *end);
 }
 
+static bool is_uint32_array(Napi::Value value) {
+  return value.IsTypedArray() && value.As<TypedArray>().TypedArrayType() == napi_uint32_array;
+}
+
+// Takes the ids as a Uint32Array and the ranges as a second Uint32Array of
+// start row, start column, end row and end column for each marker.
+void MarkerIndexWrapper::insert_many(const CallbackInfo &info) {
+  if (!is_uint32_array(info[0]) || !is_uint32_array(info[1])) {
+    Error::New(Env(), "Expected a Uint32Array of ids and a Uint32Array of ranges.").ThrowAsJavaScriptException();
+    return;
+  }
+
+  Uint32Array js_ids = info[0].As<Uint32Array>();
+  Uint32Array js_ranges = info[1].As<Uint32Array>();
+  if (js_ranges.ElementLength() != js_ids.ElementLength() * 4) {
+    Error::New(Env(), "Expected four range coordinates for each id.").ThrowAsJavaScriptException();
+    return;
+  }
+
+  vector<MarkerIndex::MarkerId> ids(js_ids.Data(), js_ids.Data() + js_ids.ElementLength());
+  for (MarkerIndex::MarkerId id : ids) {
+    if (this->marker_index->has(id)) {
+      Error::New(Env(), "Marker ids must not already be in the index.").ThrowAsJavaScriptException();
+      return;
+    }
+  }
+  vector<MarkerIndex::MarkerId> sorted_ids = ids;
+  std::sort(sorted_ids.begin(), sorted_ids.end());
+  if (std::adjacent_find(sorted_ids.begin(), sorted_ids.end()) != sorted_ids.end()) {
+    Error::New(Env(), "Marker ids must be unique.").ThrowAsJavaScriptException();
+    return;
+  }
+
+  vector<Range> ranges(ids.size());
+  std::memcpy(ranges.data(), js_ranges.Data(), ranges.size() * sizeof(Range));
+  this->marker_index->insert_many(ids, ranges);
+}
+
 void MarkerIndexWrapper::set_exclusive(const CallbackInfo &info) {
   optional<MarkerIndex::MarkerId> id = marker_id_from_js(info[0]);
   optional<bool> exclusive = bool_from_js(info[1]);
@@ -142,6 +295,42 @@ void MarkerIndexWrapper::set_exclusive(const CallbackInfo &info) {
   }
 }
 
+void MarkerIndexWrapper::set_layer(const CallbackInfo &info) {
+  optional<MarkerIndex::MarkerId> id = marker_id_from_js(info[0]);
+  if (!id) return;
+
+  optional<unsigned> layer = unsigned_from_js(info[1]);
+  if (!layer) return;
+
+  if (*layer >= MarkerIndex::MAX_LAYER_COUNT) {
+    Error::New(Env(), "Marker layers must be less than 32.").ThrowAsJavaScriptException();
+    return;
+  }
+
+  this->marker_index->set_layer(*id, *layer);
+}
+
+Napi::Value MarkerIndexWrapper::get_layer(const CallbackInfo &info) {
+  auto env = info.Env();
+  optional<MarkerIndex::MarkerId> id = marker_id_from_js(info[0]);
+  if (id) {
+    return Number::New(env, this->marker_index->get_layer(*id));
+  }
+
+  return env.Undefined();
+}
+
+// Queries take an optional trailing bit mask of the layers to search.
+void MarkerIndexWrapper::apply_layer_mask(MarkerIndex::MarkerIdSet &marker_ids, Napi::Value mask) {
+  if (mask.IsNumber()) {
+    marker_ids = this->marker_index->filter_by_layers(marker_ids, mask.As<Number>().Uint32Value());
+  }
+}
+
+MarkerIndex::LayerMask MarkerIndexWrapper::layer_mask_from_js(Napi::Value mask) {
+  return mask.IsNumber() ? mask.As<Number>().Uint32Value() : MarkerIndex::ALL_LAYERS;
+}
+
 void MarkerIndexWrapper::remove(const CallbackInfo &info) {
   optional<MarkerIndex::MarkerId> id = marker_id_from_js(info[0]);
   if (id) {
@@ -167,19 +356,50 @@ Napi::Value MarkerIndexWrapper::splice(const CallbackInfo &info) {
   optional<Point> new_extent = PointWrapper::point_from_js(info[2]);
   if (start && old_extent && new_extent) {
     MarkerIndex::SpliceResult result = this->marker_index->splice(*start, *old_extent, *new_extent);
+    return splice_result_to_js(result);
+  }
+
+  return env.Undefined();
+}
 
-    Object invalidated = Object::New(env);
-    invalidated.Set("touch", marker_ids_set_to_js(result.touch));
-    invalidated.Set("inside", marker_ids_set_to_js(result.inside));
-    invalidated.Set("inside", marker_ids_set_to_js(result.inside));
-    invalidated.Set("overlap", marker_ids_set_to_js(result.overlap));
-    invalidated.Set("surround", marker_ids_set_to_js(result.surround));
-    return invalidated;
+Napi::Value MarkerIndexWrapper::splice_packed(const CallbackInfo &info) {
+  auto env = info.Env();
+  optional<Point> start = PointWrapper::point_from_js(info[0]);
+  optional<Point> old_extent = PointWrapper::point_from_js(info[1]);
+  optional<Point> new_extent = PointWrapper::point_from_js(info[2]);
+  if (start && old_extent && new_extent) {
+    MarkerIndex::SpliceResult result = this->marker_index->splice(*start, *old_extent, *new_extent);
+    return splice_result_to_packed_js(result);
   }
 
   return env.Undefined();
 }
 
+// Takes a Uint32Array of start row, start column, old extent row, old extent
+// column, new extent row and new extent column for each splice.
+Napi::Value MarkerIndexWrapper::splice_many(const CallbackInfo &info) {
+  auto env = info.Env();
+  if (!is_uint32_array(info[0]) || info[0].As<Uint32Array>().ElementLength() % 6 != 0) {
+    Error::New(env, "Expected a Uint32Array of six coordinates for each splice.").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  Uint32Array js_splices = info[0].As<Uint32Array>();
+  vector<MarkerIndex::Splice> splices(js_splices.ElementLength() / 6);
+  std::memcpy(splices.data(), js_splices.Data(), splices.size() * sizeof(MarkerIndex::Splice));
+
+  for (size_t i = 1; i < splices.size(); i++) {
+    const MarkerIndex::Splice &previous_splice = splices[i - 1];
+    if (splices[i].start < previous_splice.start.traverse(previous_splice.old_extent)) {
+      Error::New(env, "Splices must be sorted and must not overlap.").ThrowAsJavaScriptException();
+      return env.Undefined();
+    }
+  }
+
+  MarkerIndex::SpliceResult result = this->marker_index->splice_many(splices);
+  return splice_result_to_js(result);
+}
+
 Napi::Value MarkerIndexWrapper::get_start(const CallbackInfo &info) {
   auto env = Env();
 
@@ -238,12 +458,27 @@ Napi::Value MarkerIndexWrapper::find_intersecting(const CallbackInfo &info) {
 
   if (start && end) {
     MarkerIndex::MarkerIdSet result = this->marker_index->find_intersecting(*start, *end);
+    apply_layer_mask(result, info[2]);
     return marker_ids_set_to_js(result);
   }
 
   return env.Undefined();
 }
 
+Napi::Value MarkerIndexWrapper::find_intersecting_packed(const CallbackInfo &info) {
+  auto env = info.Env();
+
+  optional<Point> start = PointWrapper::point_from_js(info[0]);
+  optional<Point> end = PointWrapper::point_from_js(info[1]);
+
+  if (start && end) {
+    MarkerIndex::MarkerIdSet result = this->marker_index->find_intersecting(*start, *end);
+    apply_layer_mask(result, info[2]);
+    return marker_ids_set_to_packed_js(result);
+  }
+  return env.Undefined();
+}
+
 Napi::Value MarkerIndexWrapper::find_containing(const CallbackInfo &info) {
   auto env = info.Env();
 
@@ -252,6 +487,7 @@ Napi::Value MarkerIndexWrapper::find_containing(const CallbackInfo &info) {
 
   if (start && end) {
     MarkerIndex::MarkerIdSet result = this->marker_index->find_containing(*start, *end);
+    apply_layer_mask(result, info[2]);
     return marker_ids_set_to_js(result);
   }
   return env.Undefined();
@@ -265,11 +501,26 @@ Napi::Value MarkerIndexWrapper::find_contained_in(const CallbackInfo &info) {
 
   if (start && end) {
     MarkerIndex::MarkerIdSet result = this->marker_index->find_contained_in(*start, *end);
+    apply_layer_mask(result, info[2]);
     return marker_ids_set_to_js(result);
   }
   return env.Undefined();
 }
 
+Napi::Value MarkerIndexWrapper::find_contained_in_packed(const CallbackInfo &info) {
+  auto env = info.Env();
+
+  optional<Point> start = PointWrapper::point_from_js(info[0]);
+  optional<Point> end = PointWrapper::point_from_js(info[1]);
+
+  if (start && end) {
+    MarkerIndex::MarkerIdSet result = this->marker_index->find_contained_in(*start, *end);
+    apply_layer_mask(result, info[2]);
+    return marker_ids_set_to_packed_js(result);
+  }
+  return env.Undefined();
+}
+
 Napi::Value MarkerIndexWrapper::find_starting_in(const CallbackInfo &info) {
   auto env = info.Env();
 
@@ -278,11 +529,26 @@ Napi::Value MarkerIndexWrapper::find_starting_in(const CallbackInfo &info) {
 
   if (start && end) {
     MarkerIndex::MarkerIdSet result = this->marker_index->find_starting_in(*start, *end);
+    apply_layer_mask(result, info[2]);
     return marker_ids_set_to_js(result);
   }
   return env.Undefined();
 }
 
+Napi::Value MarkerIndexWrapper::find_starting_in_packed(const CallbackInfo &info) {
+  auto env = info.Env();
+
+  optional<Point> start = PointWrapper::point_from_js(info[0]);
+  optional<Point> end = PointWrapper::point_from_js(info[1]);
+
+  if (start && end) {
+    MarkerIndex::MarkerIdSet result = this->marker_index->find_starting_in(*start, *end);
+    apply_layer_mask(result, info[2]);
+    return marker_ids_set_to_packed_js(result);
+  }
+  return env.Undefined();
+}
+
 Napi::Value MarkerIndexWrapper::find_starting_at(const CallbackInfo &info) {
   auto env = info.Env();
 
@@ -290,6 +556,7 @@ Napi::Value MarkerIndexWrapper::find_starting_at(const CallbackInfo &info) {
 
   if (position) {
     MarkerIndex::MarkerIdSet result = this->marker_index->find_starting_at(*position);
+    apply_layer_mask(result, info[1]);
     return marker_ids_set_to_js(result);
   }
   return env.Undefined();
@@ -303,6 +570,7 @@ Napi::Value MarkerIndexWrapper::find_ending_in(const CallbackInfo &info) {
 
   if (start && end) {
     MarkerIndex::MarkerIdSet result = this->marker_index->find_ending_in(*start, *end);
+    apply_layer_mask(result, info[2]);
     return marker_ids_set_to_js(result);
   }
   return env.Undefined();
@@ -315,6 +583,7 @@ Napi::Value MarkerIndexWrapper::find_ending_at(const CallbackInfo &info) {
 
   if (position) {
     MarkerIndex::MarkerIdSet result = this->marker_index->find_ending_at(*position);
+    apply_layer_mask(result, info[1]);
     return marker_ids_set_to_js(result);
   }
   return env.Undefined();
@@ -349,7 +618,64 @@ Napi::Value MarkerIndexWrapper::find_boundaries_after(const CallbackInfo &info)
   return env.Undefined();
 }
 
+// Returns the ids of the nearest markers as an array, ordered by distance
+// from the given position.
+Napi::Value MarkerIndexWrapper::find_next_starting_after(const CallbackInfo &info) {
+  auto env = info.Env();
+  optional<Point> position = PointWrapper::point_from_js(info[0]);
+
+  if (position && info[1].IsNumber()) {
+    size_t count = info[1].As<Number>().Uint32Value();
+    return marker_ids_vector_to_js(
+      this->marker_index->find_next_starting_after(*position, count, layer_mask_from_js(info[2]))
+    );
+  }
+  return env.Undefined();
+}
+
+Napi::Value MarkerIndexWrapper::find_previous_ending_before(const CallbackInfo &info) {
+  auto env = info.Env();
+  optional<Point> position = PointWrapper::point_from_js(info[0]);
+
+  if (position && info[1].IsNumber()) {
+    size_t count = info[1].As<Number>().Uint32Value();
+    return marker_ids_vector_to_js(
+      this->marker_index->find_previous_ending_before(*position, count, layer_mask_from_js(info[2]))
+    );
+  }
+  return env.Undefined();
+}
+
+Napi::Value MarkerIndexWrapper::create_boundary_cursor(const CallbackInfo &info) {
+  return BoundaryCursorWrapper::new_instance(info.Env(), info.This().As<Object>(), this->marker_index.get());
+}
+
 Napi::Value MarkerIndexWrapper::dump(const CallbackInfo &info) {
   unordered_map<MarkerIndex::MarkerId, Range> snapshot = this->marker_index->dump();
   return snapshot_to_js(snapshot);
 }
+
+// Returns the ids in ascending order as a Uint32Array, along with a second
+// Uint32Array holding the start row, start column, end row and end column of
+// each marker, the same layout that `insertMany` accepts.
+Napi::Value MarkerIndexWrapper::dump_packed(const CallbackInfo &info) {
+  auto env = info.Env();
+  unordered_map<MarkerIndex::MarkerId, Range> snapshot = this->marker_index->dump();
+
+  vector<MarkerIndex::MarkerId> ids;
+  ids.reserve(snapshot.size());
+  for (auto &pair : snapshot) ids.push_back(pair.first);
+  std::sort(ids.begin(), ids.end());
+
+  Uint32Array js_ids = Uint32Array::New(env, ids.size());
+  Uint32Array js_ranges = Uint32Array::New(env, ids.size() * 4);
+  std::memcpy(js_ids.Data(), ids.data(), ids.size() * sizeof(MarkerIndex::MarkerId));
+  for (size_t i = 0; i < ids.size(); i++) {
+    std::memcpy(js_ranges.Data() + i * 4, &snapshot[ids[i]], sizeof(Range));
+  }
+
+  Object result = Object::New(env);
+  result.Set("ids", js_ids);
+  result.Set("ranges", js_ranges);
+  return result;
+}
@@ -0,0 +1,72 @@
+#include "addon-data.h"
+#include "patch-history-wrapper.h"
+#include "patch-wrapper.h"
+#include "number-conversion.h"
+
+using namespace Napi;
+
+void PatchHistoryWrapper::init(Napi::Env env, Object exports) {
+  auto *data = env.GetInstanceData<AddonData>();
+
+  Function func = DefineClass(env, "PatchHistory", {
+    InstanceMethod<&PatchHistoryWrapper::push>("push"),
+    InstanceMethod<&PatchHistoryWrapper::truncate>("truncate"),
+    InstanceMethod<&PatchHistoryWrapper::clear>("clear"),
+    InstanceMethod<&PatchHistoryWrapper::get_checkpoint>("getCheckpoint"),
+    InstanceMethod<&PatchHistoryWrapper::compose>("compose"),
+  });
+
+  data->patch_history_wrapper_constructor = Napi::Persistent(func);
+  exports.Set("PatchHistory", func);
+}
+
+PatchHistoryWrapper::PatchHistoryWrapper(const CallbackInfo &info): ObjectWrap<PatchHistoryWrapper>(info) {}
+
+Napi::Value PatchHistoryWrapper::push(const CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  Patch *patch = PatchWrapper::from_js(info[0]);
+  if (!patch) {
+    Error::New(env, "PatchHistory.push must be called with a patch").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  if (!patch_history.push(patch->copy())) {
+    Error::New(env, "Patch does not apply").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  return Number::New(env, patch_history.size());
+}
+
+void PatchHistoryWrapper::truncate(const CallbackInfo &info) {
+  auto checkpoint = number_conversion::number_from_js<uint32_t>(info[0]);
+  if (checkpoint) {
+    patch_history.truncate(*checkpoint);
+  }
+}
+
+void PatchHistoryWrapper::clear(const CallbackInfo &info) {
+  patch_history.clear();
+}
+
+Napi::Value PatchHistoryWrapper::get_checkpoint(const CallbackInfo &info) {
+  return Number::New(info.Env(), patch_history.size());
+}
+
+Napi::Value PatchHistoryWrapper::compose(const CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  auto start_checkpoint = number_conversion::number_from_js<uint32_t>(info[0]);
+  auto end_checkpoint = number_conversion::number_from_js<uint32_t>(info[1]);
+
+  if (start_checkpoint && end_checkpoint) {
+    auto result = patch_history.compose(*start_checkpoint, *end_checkpoint);
+    if (!result) {
+      Error::New(env, "Invalid checkpoint").ThrowAsJavaScriptException();
+      return env.Undefined();
+    }
+    return PatchWrapper::from_patch(env, std::move(*result));
+  }
+
+  return env.Undefined();
+}
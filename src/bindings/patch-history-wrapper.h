@@ -0,0 +1,20 @@
+#pragma once
+
+#include "napi.h"
+#include "patch-history.h"
+
+class PatchHistoryWrapper : public Napi::ObjectWrap<PatchHistoryWrapper> {
+ public:
+  static void init(Napi::Env env, Napi::Object exports);
+
+  explicit PatchHistoryWrapper(const Napi::CallbackInfo &info);
+
+ private:
+  Napi::Value push(const Napi::CallbackInfo &info);
+  void truncate(const Napi::CallbackInfo &info);
+  void clear(const Napi::CallbackInfo &info);
+  Napi::Value get_checkpoint(const Napi::CallbackInfo &info);
+  Napi::Value compose(const Napi::CallbackInfo &info);
+
+  PatchHistory patch_history;
+};
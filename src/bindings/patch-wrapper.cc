@@ -1,3 +1,4 @@
+#include <cstring>
 #include <memory>
 #include <sstream>
 #include <vector>
@@ -77,6 +78,8 @@ void PatchWrapper::init(Napi::Env env, Object exports) {
     InstanceMethod<&PatchWrapper::get_changes_in_new_range>("getChangesInNewRange"),
     InstanceMethod<&PatchWrapper::change_for_old_position>("changeForOldPosition"),
     InstanceMethod<&PatchWrapper::change_for_new_position>("changeForNewPosition"),
+    InstanceMethod<&PatchWrapper::translate_old_to_new>("translateOldToNew"),
+    InstanceMethod<&PatchWrapper::translate_new_to_old>("translateNewToOld"),
     InstanceMethod<&PatchWrapper::serialize>("serialize"),
     InstanceMethod<&PatchWrapper::get_dot_graph>("getDotGraph"),
     InstanceMethod<&PatchWrapper::get_json>("getJSON"),
@@ -98,6 +101,15 @@ Napi::Value PatchWrapper::from_patch(Napi::Env env, Patch &&patch) {
   return js_patch;
 }
 
+Patch *PatchWrapper::from_js(Napi::Value value) {
+  auto *data = value.Env().GetInstanceData<AddonData>();
+  if (!value.IsObject() || !value.As<Object>().InstanceOf(data->patch_wrapper_constructor.Value())) {
+    return nullptr;
+  }
+
+  return &Unwrap(value.As<Object>())->patch;
+}
+
 PatchWrapper::PatchWrapper(const CallbackInfo &info): ObjectWrap<PatchWrapper>(info) {
   if (info[0].IsExternal()) {
     auto patch = info[0].As<Napi::External<Patch>>();
@@ -259,6 +271,41 @@ Napi::Value PatchWrapper::change_for_new_position(const CallbackInfo &info) {
   return env.Undefined();
 }
 
+// Points are passed in both directions as flat row, column pairs, so a whole
+// batch crosses the boundary in a single call.
+static_assert(sizeof(Point) == 2 * sizeof(uint32_t), "Points must be copyable as row, column pairs");
+
+static optional<vector<Point>> points_from_js(Napi::Value value) {
+  if (!value.IsTypedArray() || value.As<TypedArray>().TypedArrayType() != napi_uint32_array ||
+      value.As<TypedArray>().ElementLength() % 2 != 0) {
+    TypeError::New(value.Env(), "Expected a Uint32Array of row, column pairs").ThrowAsJavaScriptException();
+    return optional<vector<Point>>{};
+  }
+
+  Uint32Array js_array = value.As<Uint32Array>();
+  vector<Point> points(js_array.ElementLength() / 2);
+  memcpy(points.data(), js_array.Data(), points.size() * sizeof(Point));
+  return points;
+}
+
+static Napi::Value points_to_js(Napi::Env env, const vector<Point> &points) {
+  Uint32Array js_array = Uint32Array::New(env, points.size() * 2);
+  memcpy(js_array.Data(), points.data(), points.size() * sizeof(Point));
+  return js_array;
+}
+
+Napi::Value PatchWrapper::translate_old_to_new(const CallbackInfo &info) {
+  auto old_positions = points_from_js(info[0]);
+  if (!old_positions) return info.Env().Undefined();
+  return points_to_js(info.Env(), patch.translate_old_to_new(*old_positions));
+}
+
+Napi::Value PatchWrapper::translate_new_to_old(const CallbackInfo &info) {
+  auto new_positions = points_from_js(info[0]);
+  if (!new_positions) return info.Env().Undefined();
+  return points_to_js(info.Env(), patch.translate_new_to_old(*new_positions));
+}
+
 Napi::Value PatchWrapper::serialize(const CallbackInfo &info) {
   Patch &patch = this->patch;
 
@@ -274,9 +321,7 @@ Napi::Value PatchWrapper::deserialize(const CallbackInfo &info) {
 
   if (info.Length() > 0 && info[0].IsTypedArray()) {
     Uint8Array js_array = info[0].As<Uint8Array>();
-    static vector<uint8_t> input;
-    input.assign(js_array.Data(), js_array.Data() + js_array.ByteLength());
-    Deserializer deserializer(input);
+    Deserializer deserializer(js_array.Data(), js_array.ByteLength());
     return from_patch(env, Patch{deserializer});
   }
 
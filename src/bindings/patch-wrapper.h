@@ -5,6 +5,7 @@ class PatchWrapper : public Napi::ObjectWrap<PatchWrapper> {
  public:
   static void init(Napi::Env env, Napi::Object exports);
   static Napi::Value from_patch(Napi::Env, Patch &&);
+  static Patch *from_js(Napi::Value);
 
   explicit PatchWrapper(const Napi::CallbackInfo &info);
 
@@ -21,6 +22,8 @@ class PatchWrapper : public Napi::ObjectWrap<PatchWrapper> {
   Napi::Value get_changes_in_new_range(const Napi::CallbackInfo &info);
   Napi::Value change_for_old_position(const Napi::CallbackInfo &info);
   Napi::Value change_for_new_position(const Napi::CallbackInfo &info);
+  Napi::Value translate_old_to_new(const Napi::CallbackInfo &info);
+  Napi::Value translate_new_to_old(const Napi::CallbackInfo &info);
   Napi::Value serialize(const Napi::CallbackInfo &info);
   Napi::Value get_dot_graph(const Napi::CallbackInfo &info);
   Napi::Value get_json(const Napi::CallbackInfo &info);
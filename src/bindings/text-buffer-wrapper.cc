@@ -1,5 +1,7 @@
 #include <sstream>
 #include <iomanip>
+#include <atomic>
+#include <chrono>
 #include <stdio.h>
 #include <sys/stat.h>
 #include <iostream>
@@ -88,14 +90,13 @@ public:
     }
   }
 
-  static const Regex *regex_from_js(const Napi::Value &value) {
+  // Compiles a new regex from a RegExp or the source of one.
+  static std::unique_ptr<Regex> new_regex_from_js(const Napi::Value &value) {
     auto env = value.Env();
-    auto *data = env.GetInstanceData<AddonData>();
 
     String js_pattern;
     bool ignore_case = false;
     bool unicode = false;
-    Object js_regex;
 
     if (value.IsString()) {
       js_pattern = value.As<String>();
@@ -106,15 +107,6 @@ public:
           return nullptr;
       }
 
-      // Check if there is any cached regex inside the js object.
-      js_regex = value.As<Object>();
-      if (js_regex.Has(REGEX_CACHE_KEY)) {
-        Napi::Value js_regex_wrapper = js_regex.Get(REGEX_CACHE_KEY);
-        if (js_regex_wrapper.IsObject()) {
-          return Unwrap(js_regex_wrapper.As<Object>())->regex.get();
-        }
-      }
-
       // Extract necessary parameters from RegExp
       v8::Local<v8::RegExp> v8_regex = js_regex_value.As<v8::RegExp>();
       js_pattern = Napi::Value(env, JsValueFromV8LocalValue(v8_regex->GetSource())).As<String>();
@@ -125,14 +117,37 @@ public:
     // initialize Regex
     u16string error_message;
     optional<u16string> pattern = string_conversion::string_from_js(js_pattern);
-    Regex regex = Regex(*pattern, &error_message, ignore_case, unicode);
+    std::unique_ptr<Regex> regex{new Regex(*pattern, &error_message, ignore_case, unicode)};
     if (!error_message.empty()) {
       Napi::Error::New(env, string_conversion::string_to_js(env, error_message)).ThrowAsJavaScriptException();
       return nullptr;
     }
+    return regex;
+  }
+
+  // Returns the regex for a RegExp or the source of one. The regex compiled
+  // for a RegExp is cached on it, and is owned by that RegExp.
+  static const Regex *regex_from_js(const Napi::Value &value) {
+    auto env = value.Env();
+    auto *data = env.GetInstanceData<AddonData>();
+
+    // Check if there is any cached regex inside the js object.
+    Object js_regex;
+    if (value.IsObject() && V8LocalValueFromJsValue(value)->IsRegExp()) {
+      js_regex = value.As<Object>();
+      if (js_regex.Has(REGEX_CACHE_KEY)) {
+        Napi::Value js_regex_wrapper = js_regex.Get(REGEX_CACHE_KEY);
+        if (js_regex_wrapper.IsObject()) {
+          return Unwrap(js_regex_wrapper.As<Object>())->regex.get();
+        }
+      }
+    }
+
+    std::unique_ptr<Regex> regex = new_regex_from_js(value);
+    if (!regex) return nullptr;
 
     // initialize RegexWrapper
-    auto wrapper = External<Regex>::New(env, new Regex(move(regex)));
+    auto wrapper = External<Regex>::New(env, regex.release());
     auto js_regex_wrapper = data->regex_constructor.New({wrapper});
 
     // cache Regex
@@ -143,6 +158,49 @@ public:
     return Unwrap(js_regex_wrapper)->regex.get();
   }
 
+  // Builds a regex that searches for all of the patterns in the given array
+  // at once. Strings are searched for literally, while RegExps keep their own
+  // `i` flag, and make the whole search unicode-aware if any has the `u` flag.
+  static std::unique_ptr<Regex> multi_regex_from_js(const Napi::Value &value) {
+    auto env = value.Env();
+    if (!value.IsArray()) {
+      Napi::Error::New(env, "Argument must be an array of strings or RegExps").ThrowAsJavaScriptException();
+      return nullptr;
+    }
+
+    auto js_patterns = value.As<Array>();
+    vector<Regex::Pattern> patterns;
+    bool unicode = false;
+    for (uint32_t i = 0, n = js_patterns.Length(); i < n; i++) {
+      Napi::Value js_pattern = js_patterns[i];
+      if (js_pattern.IsString()) {
+        optional<u16string> source = string_conversion::string_from_js(js_pattern);
+        patterns.push_back({move(*source), true, false});
+        continue;
+      }
+
+      v8::Local<v8::Value> js_regex_value = V8LocalValueFromJsValue(js_pattern);
+      if (!js_pattern.IsObject() || !js_regex_value->IsRegExp()) {
+        Napi::Error::New(env, "Argument must be an array of strings or RegExps").ThrowAsJavaScriptException();
+        return nullptr;
+      }
+      v8::Local<v8::RegExp> v8_regex = js_regex_value.As<v8::RegExp>();
+      optional<u16string> source = string_conversion::string_from_js(
+        Napi::Value(env, JsValueFromV8LocalValue(v8_regex->GetSource()))
+      );
+      patterns.push_back({move(*source), false, bool(v8_regex->GetFlags() & v8::RegExp::kIgnoreCase)});
+      if (v8_regex->GetFlags() & v8::RegExp::kUnicode) unicode = true;
+    }
+
+    u16string error_message;
+    std::unique_ptr<Regex> regex{new Regex(patterns, &error_message, unicode)};
+    if (!error_message.empty()) {
+      Napi::Error::New(env, string_conversion::string_to_js(env, error_message)).ThrowAsJavaScriptException();
+      return nullptr;
+    }
+    return regex;
+  }
+
   static void init(Napi::Env env) {
     auto *data = env.GetInstanceData<AddonData>();
 
@@ -243,12 +301,17 @@ void TextBufferWrapper::init(Napi::Env env, Object exports) {
     InstanceMethod<&TextBufferWrapper::load_sync>("loadSync", napi_default_method),
     InstanceMethod<&TextBufferWrapper::serialize_changes>("serializeChanges", napi_default_method),
     InstanceMethod<&TextBufferWrapper::deserialize_changes>("deserializeChanges", napi_default_method),
+    InstanceMethod<&TextBufferWrapper::serialize_changes_to_file>("serializeChangesToFile", napi_default_method),
+    InstanceMethod<&TextBufferWrapper::deserialize_changes_from_file>("deserializeChangesFromFile", napi_default_method),
     InstanceMethod<&TextBufferWrapper::reset>("reset", napi_default_method),
     InstanceMethod<&TextBufferWrapper::base_text_digest>("baseTextDigest", napi_default_method),
     InstanceMethod<&TextBufferWrapper::find>("find", napi_default_method),
     InstanceMethod<&TextBufferWrapper::find_sync>("findSync", napi_default_method),
     InstanceMethod<&TextBufferWrapper::find_all>("findAll", napi_default_method),
     InstanceMethod<&TextBufferWrapper::find_all_sync>("findAllSync", napi_default_method),
+    InstanceMethod<&TextBufferWrapper::find_all_in_batches>("findAllInBatches", napi_default_method),
+    InstanceMethod<&TextBufferWrapper::find_all_multi>("findAllMulti", napi_default_method),
+    InstanceMethod<&TextBufferWrapper::find_all_multi_sync>("findAllMultiSync", napi_default_method),
     InstanceMethod<&TextBufferWrapper::find_and_mark_all_sync>("findAndMarkAllSync", napi_default_method),
     InstanceMethod<&TextBufferWrapper::find_words_with_subsequence_in_range>("findWordsWithSubsequenceInRange", napi_default_method),
     InstanceMethod<&TextBufferWrapper::dot_graph>("getDotGraph", napi_default_method),
@@ -259,6 +322,10 @@ void TextBufferWrapper::init(Napi::Env env, Object exports) {
   exports.Set("TextBuffer", func);
 }
 
+std::unique_ptr<Regex> TextBufferWrapper::new_regex_from_js(const Napi::Value &value) {
+  return RegexWrapper::new_regex_from_js(value);
+}
+
 TextBufferWrapper::TextBufferWrapper(const CallbackInfo &info): ObjectWrap<TextBufferWrapper>(info) {
   if (info.Length() > 0 && info[0].IsString()) {
     auto text = string_conversion::string_from_js(info[0]);
@@ -417,10 +484,27 @@ Napi::Value TextBufferWrapper::position_for_character_index(const CallbackInfo &
   return env.Undefined();
 }
 
+static_assert(sizeof(Range) == 4 * sizeof(uint32_t), "Ranges must be copyable as four uint32s");
+
+static Value encode_ranges(Env env, const Range *ranges, size_t count) {
+  auto length = count * 4;
+  Uint32Array js_array_buffer = Uint32Array::New(env, length);
+  memcpy(js_array_buffer.Data(), ranges, length * sizeof(uint32_t));
+  return js_array_buffer;
+}
+
 static Value encode_ranges(Env env, const vector<Range> &ranges) {
-  auto length = ranges.size() * 4;
+  return encode_ranges(env, ranges.data(), ranges.size());
+}
+
+static_assert(sizeof(TextBuffer::PatternMatch) == 5 * sizeof(uint32_t), "Pattern matches must be copyable as five uint32s");
+
+// Packs each match into five numbers: the index of the pattern it matched,
+// followed by its range.
+static Value encode_pattern_matches(Env env, const vector<TextBuffer::PatternMatch> &matches) {
+  auto length = matches.size() * 5;
   Uint32Array js_array_buffer = Uint32Array::New(env, length);
-  memcpy(js_array_buffer.Data(), ranges.data(), length * sizeof(uint32_t));
+  memcpy(js_array_buffer.Data(), matches.data(), length * sizeof(uint32_t));
   return js_array_buffer;
 }
 
@@ -461,6 +545,120 @@ public:
   }
 };
 
+// Matches are handed to JavaScript once this many have been found, or once
+// this long has passed since the last batch, whichever comes first.
+static const size_t SEARCH_BATCH_SIZE = 10000;
+static const std::chrono::milliseconds SEARCH_BATCH_INTERVAL{16};
+
+// When given a priority range, such as the rows that are visible on screen,
+// the batch searcher sends the matches in its rows first, so that the first
+// batches don't have to wait for the rest of the buffer to be searched.
+class TextBufferBatchSearcher : public Napi::AsyncProgressQueueWorker<Range> {
+  const TextBuffer::Snapshot *snapshot;
+  const Regex *regex;
+  Range search_range;
+  optional<Range> priority_range;
+  size_t max_count;
+  FunctionReference batch_callback;
+  std::atomic<bool> cancelled;
+  size_t match_count;
+  size_t reported_match_count;
+
+public:
+  TextBufferBatchSearcher(Function &completion_callback,
+                          Function &batch_callback,
+                          const TextBuffer::Snapshot *snapshot,
+                          const Regex *regex,
+                          const Range &search_range,
+                          optional<Range> priority_range,
+                          size_t max_count) :
+    AsyncProgressQueueWorker(completion_callback, "TextBuffer.findAllInBatches"),
+    snapshot{snapshot},
+    regex{regex},
+    search_range(search_range),
+    priority_range(priority_range),
+    max_count{max_count},
+    batch_callback{Persistent(batch_callback)},
+    cancelled{false},
+    match_count{0},
+    reported_match_count{0} {
+  }
+
+  void Execute(const ExecutionProgress &progress) override {
+    if (max_count == 0) return;
+    vector<Range> batch;
+    auto last_batch_time = std::chrono::steady_clock::now();
+    auto send_batch = [&]() {
+      if (!batch.empty()) progress.Send(batch.data(), batch.size());
+      batch.clear();
+      last_batch_time = std::chrono::steady_clock::now();
+    };
+    auto add_match = [&](Range match) -> bool {
+      if (cancelled) return true;
+      batch.push_back(match);
+      match_count++;
+      if (batch.size() >= SEARCH_BATCH_SIZE ||
+          std::chrono::steady_clock::now() - last_batch_time >= SEARCH_BATCH_INTERVAL) {
+        send_batch();
+      }
+      return match_count >= max_count;
+    };
+
+    if (priority_range) {
+      snapshot->find_each_prioritized(*regex, *priority_range, add_match, send_batch, search_range);
+    } else {
+      snapshot->find_each(*regex, add_match, search_range);
+    }
+    send_batch();
+  }
+
+  // A batch callback that returns false cancels the search. Batches that were
+  // already sent before the search noticed are dropped.
+  void OnProgress(const Range *matches, size_t count) override {
+    if (cancelled || !matches) return;
+    auto env = Env();
+    reported_match_count += count;
+    Napi::Value result = batch_callback.Call({encode_ranges(env, matches, count)});
+    if (!result.IsEmpty() && result.IsBoolean() && !result.As<Boolean>().Value()) cancelled = true;
+  }
+
+  void OnOK() override {
+    auto env = Env();
+    delete snapshot;
+    snapshot = nullptr;
+    Callback().Call({env.Null(), Number::New(env, reported_match_count)});
+  }
+};
+
+class TextBufferMultiSearcher : public Napi::AsyncWorker {
+  const TextBuffer::Snapshot *snapshot;
+  std::unique_ptr<Regex> regex;
+  Range search_range;
+  vector<TextBuffer::PatternMatch> matches;
+
+public:
+  TextBufferMultiSearcher(Function &completion_callback,
+                          const TextBuffer::Snapshot *snapshot,
+                          std::unique_ptr<Regex> regex,
+                          const Range &search_range) :
+    AsyncWorker(completion_callback, "TextBuffer.findAllMulti"),
+    snapshot{snapshot},
+    regex{move(regex)},
+    search_range(search_range) {
+  }
+
+  void Execute() override {
+    matches = snapshot->find_all_multi(*regex, search_range);
+  }
+
+  void OnOK() override {
+    auto env = Env();
+    delete snapshot;
+    snapshot = nullptr;
+    Callback().Call({env.Null(), encode_pattern_matches(env, matches)});
+  }
+};
+
 Napi::Value TextBufferWrapper::find_sync(const CallbackInfo &info) {
   auto env = info.Env();
   auto &text_buffer = this->text_buffer;
@@ -507,6 +705,28 @@ Napi::Value TextBufferWrapper::find_all_sync(const CallbackInfo &info) {
   return env.Undefined();
 }
 
+Napi::Value TextBufferWrapper::find_all_multi_sync(const CallbackInfo &info) {
+  auto env = info.Env();
+  auto &text_buffer = this->text_buffer;
+  auto regex = RegexWrapper::multi_regex_from_js(info[0]);
+  if (regex) {
+    optional<Range> search_range;
+    if (info[1].IsObject()) {
+      search_range = RangeWrapper::range_from_js(info[1]);
+      if (!search_range) return env.Null();
+    }
+
+    auto matches = text_buffer.find_all_multi(
+      *regex,
+      search_range ? *search_range : Range::all_inclusive()
+    );
+
+    return encode_pattern_matches(env, matches);
+  }
+
+  return env.Undefined();
+}
+
 Napi::Value TextBufferWrapper::find_and_mark_all_sync(const CallbackInfo &info) {
   auto env = info.Env();
   auto &text_buffer = this->text_buffer;
@@ -587,6 +807,56 @@ void TextBufferWrapper::find_all(const CallbackInfo &info) {
   }
 }
 
+void TextBufferWrapper::find_all_in_batches(const CallbackInfo &info) {
+  auto &text_buffer = this->text_buffer;
+  auto batch_callback = info[4].As<Function>();
+  auto completion_callback = info[5].As<Function>();
+  const Regex *regex = RegexWrapper::regex_from_js(info[0]);
+  if (regex) {
+    optional<Range> search_range;
+    if (info[1].IsObject()) {
+      search_range = RangeWrapper::range_from_js(info[1]);
+      if (!search_range) return;
+    }
+    optional<uint32_t> max_count = number_conversion::number_from_js<uint32_t>(info[2]);
+    optional<Range> priority_range;
+    if (info[3].IsObject()) {
+      priority_range = RangeWrapper::range_from_js(info[3]);
+      if (!priority_range) return;
+    }
+    auto async_worker = new TextBufferBatchSearcher(
+      completion_callback,
+      batch_callback,
+      text_buffer.create_snapshot(),
+      regex,
+      search_range ? *search_range : Range::all_inclusive(),
+      priority_range,
+      max_count ? *max_count : SIZE_MAX
+    );
+    async_worker->Queue();
+  }
+}
+
+void TextBufferWrapper::find_all_multi(const CallbackInfo &info) {
+  auto &text_buffer = this->text_buffer;
+  auto callback = info[1].As<Function>();
+  auto regex = RegexWrapper::multi_regex_from_js(info[0]);
+  if (regex) {
+    optional<Range> search_range;
+    if (info[2].IsObject()) {
+      search_range = RangeWrapper::range_from_js(info[2]);
+      if (!search_range) return;
+    }
+    auto async_worker = new TextBufferMultiSearcher(
+      callback,
+      text_buffer.create_snapshot(),
+      move(regex),
+      search_range ? *search_range : Range::all_inclusive()
+    );
+    async_worker->Queue();
+  }
+}
+
 void TextBufferWrapper::find_words_with_subsequence_in_range(const CallbackInfo &info) {
   class FindWordsWithSubsequenceInRangeWorker : public Napi::AsyncWorker {
     Napi::ObjectReference buffer;
@@ -639,7 +909,7 @@ void TextBufferWrapper::find_words_with_subsequence_in_range(const CallbackInfo
       if (!snapshot) {
         return;
       }
-      result = snapshot->find_words_with_subsequence_in_range(query, extra_word_characters, range);
+      result = snapshot->find_words_with_subsequence_in_range(query, extra_word_characters, range, max_count);
     }
 
     void OnOK() override {
@@ -649,6 +919,7 @@ void TextBufferWrapper::find_words_with_subsequence_in_range(const CallbackInfo
         return;
       }
 
+      text_buffer_wrapper->text_buffer.adopt_word_index(snapshot);
       delete snapshot;
       snapshot = nullptr;
 
@@ -663,7 +934,7 @@ void TextBufferWrapper::find_words_with_subsequence_in_range(const CallbackInfo
       uint32_t *positions_data = reinterpret_cast<uint32_t *>(positions_buffer.Data());
 
       uint32_t positions_array_index = 0;
-      for (size_t i = 0; i < result.size() && i < max_count; i++) {
+      for (size_t i = 0; i < result.size(); i++) {
         const SubsequenceMatch &match = result[i];
         positions_data[positions_array_index++] = match.positions.size();
         uint32_t bytes_to_copy = match.positions.size() * sizeof(Point);
@@ -1182,14 +1453,98 @@ void TextBufferWrapper::deserialize_changes(const CallbackInfo &info) {
   auto &text_buffer = this->text_buffer;
   if (info[0].IsTypedArray()) {
     Uint8Array array = info[0].As<Uint8Array>();
-    uint8_t *data = array.Data();
-    static vector<uint8_t> input;
-    input.assign(data, data + array.ByteLength());
-    Deserializer deserializer(input);
+    Deserializer deserializer(array.Data(), array.ByteLength());
     text_buffer.deserialize_changes(deserializer);
   }
 }
 
+class SerializeWorker : public AsyncWorker {
+  TextBuffer::Snapshot *snapshot;
+  string file_name;
+  optional<textbuffer::Error> error;
+
+ public:
+  SerializeWorker(Function &completion_callback, TextBuffer::Snapshot *snapshot, string &&file_name) :
+    AsyncWorker(completion_callback, "TextBuffer.serializeChangesToFile"),
+    snapshot{snapshot},
+    file_name{move(file_name)} {}
+
+  void Execute() override {
+    FILE *file = open_file(file_name, "wb");
+    if (!file) {
+      error = textbuffer::Error{errno, "open"};
+      return;
+    }
+
+    vector<uint8_t> output_buffer;
+    Serializer serializer(output_buffer, [file](const uint8_t *data, size_t size) {
+      return fwrite(data, 1, size, file) == size;
+    }, CHUNK_SIZE);
+    snapshot->serialize_changes(serializer);
+    if (!serializer.flush()) {
+      error = textbuffer::Error{errno, "write"};
+    }
+
+    fclose(file);
+  }
+
+  void OnOK() override {
+    auto env = Env();
+    delete snapshot;
+    snapshot = nullptr;
+    if (error) {
+      Callback().Call({error_to_js(env, *error, "", file_name)});
+    } else {
+      Callback().Call({env.Null()});
+    }
+  }
+};
+
+void TextBufferWrapper::serialize_changes_to_file(const CallbackInfo &info) {
+  auto &text_buffer = this->text_buffer;
+
+  if (!info[0].IsString()) return;
+  String js_file_path = info[0].As<String>();
+  string file_path = js_file_path.Utf8Value();
+
+  Function completion_callback = info[1].As<Function>();
+  (new SerializeWorker(
+    completion_callback,
+    text_buffer.create_snapshot(),
+    move(file_path)
+  ))->Queue();
+}
+
+Napi::Value TextBufferWrapper::deserialize_changes_from_file(const CallbackInfo &info) {
+  auto env = info.Env();
+  auto &text_buffer = this->text_buffer;
+
+  if (!info[0].IsString()) return env.Undefined();
+  String js_file_path = info[0].As<String>();
+  string file_path = js_file_path.Utf8Value();
+
+  FILE *file = open_file(file_path, "rb");
+  if (!file) {
+    textbuffer::error_to_js(env, textbuffer::Error{errno, "open"}, "", file_path).As<Error>().ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  Deserializer deserializer([file](uint8_t *data, size_t size) {
+    return fread(data, 1, size, file);
+  }, CHUNK_SIZE);
+  bool result = text_buffer.deserialize_changes(deserializer);
+  bool read_failed = ferror(file);
+  int read_error = errno;
+  fclose(file);
+
+  if (read_failed) {
+    textbuffer::error_to_js(env, textbuffer::Error{read_error, "read"}, "", file_path).As<Error>().ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  return Boolean::New(env, result);
+}
+
 void TextBufferWrapper::reset(const CallbackInfo &info) {
   auto &text_buffer = this->text_buffer;
   auto text = string_conversion::string_from_js(info[0]);
@@ -1,6 +1,7 @@
 #ifndef SUPERSTRING_TEXT_BUFFER_WRAPPER_H
 #define SUPERSTRING_TEXT_BUFFER_WRAPPER_H
 
+#include <memory>
 #include <unordered_set>
 
 #include "napi.h"
@@ -20,6 +21,11 @@ public:
 
   explicit TextBufferWrapper(const Napi::CallbackInfo &info);
 
+  // Compiles a regex that the caller owns from a RegExp or the source of one,
+  // the same way that the buffer's search methods do. Throws a JS error and
+  // returns null if the pattern is invalid.
+  static std::unique_ptr<Regex> new_regex_from_js(const Napi::Value &value);
+
 private:
   Napi::Value get_length(const Napi::CallbackInfo &info);
   Napi::Value get_extent(const Napi::CallbackInfo &info);
@@ -40,6 +46,9 @@ private:
   Napi::Value find_sync(const Napi::CallbackInfo &info);
   void find_all(const Napi::CallbackInfo &info);
   Napi::Value find_all_sync(const Napi::CallbackInfo &info);
+  void find_all_in_batches(const Napi::CallbackInfo &info);
+  void find_all_multi(const Napi::CallbackInfo &info);
+  Napi::Value find_all_multi_sync(const Napi::CallbackInfo &info);
   Napi::Value find_and_mark_all_sync(const Napi::CallbackInfo &info);
   void find_words_with_subsequence_in_range(const Napi::CallbackInfo &info);
   Napi::Value is_modified(const Napi::CallbackInfo &info);
@@ -50,6 +59,8 @@ private:
   Napi::Value save_sync(const Napi::CallbackInfo &info);
   Napi::Value serialize_changes(const Napi::CallbackInfo &info);
   void deserialize_changes(const Napi::CallbackInfo &info);
+  void serialize_changes_to_file(const Napi::CallbackInfo &info);
+  Napi::Value deserialize_changes_from_file(const Napi::CallbackInfo &info);
   void reset(const Napi::CallbackInfo &info);
   Napi::Value base_text_digest(const Napi::CallbackInfo &info);
   Napi::Value get_snapshot(const Napi::CallbackInfo &info);
@@ -0,0 +1,169 @@
+#include "addon-data.h"
+#include "word-corpus-wrapper.h"
+#include "number-conversion.h"
+#include "point-wrapper.h"
+#include "string-conversion.h"
+#include "text-buffer-wrapper.h"
+
+using namespace Napi;
+using std::move;
+using std::pair;
+using std::u16string;
+using std::vector;
+
+void WordCorpusWrapper::init(Napi::Env env, Object exports) {
+  auto *data = env.GetInstanceData<AddonData>();
+
+  Napi::Function func = DefineClass(env, "WordCorpus", {
+    InstanceMethod<&WordCorpusWrapper::add_buffer>("addBuffer", napi_default_method),
+    InstanceMethod<&WordCorpusWrapper::remove_buffer>("removeBuffer", napi_default_method),
+    InstanceMethod<&WordCorpusWrapper::get_buffer_count>("getBufferCount", napi_default_method),
+    InstanceMethod<&WordCorpusWrapper::find_words_with_subsequence>("findWordsWithSubsequence", napi_default_method),
+  });
+
+  data->word_corpus_wrapper_constructor = Napi::Persistent(func);
+  exports.Set("WordCorpus", func);
+}
+
+WordCorpusWrapper::WordCorpusWrapper(const CallbackInfo &info): ObjectWrap<WordCorpusWrapper>(info) {}
+
+optional<WordCorpus::BufferId> WordCorpusWrapper::buffer_id_for_js(Napi::Value js_buffer) {
+  for (const auto &entry : js_buffers) {
+    if (entry.second.Value().StrictEquals(js_buffer)) return entry.first;
+  }
+  return optional<WordCorpus::BufferId>{};
+}
+
+void WordCorpusWrapper::add_buffer(const CallbackInfo &info) {
+  auto *data = info.Env().GetInstanceData<AddonData>();
+  if (!info[0].IsObject() || !info[0].As<Object>().InstanceOf(data->text_buffer_wrapper_constructor.Value())) {
+    Napi::Error::New(info.Env(), "Invalid arguments").ThrowAsJavaScriptException();
+    return;
+  }
+
+  if (buffer_id_for_js(info[0])) return;
+
+  Object js_buffer = info[0].As<Object>();
+  TextBufferWrapper *text_buffer_wrapper = TextBufferWrapper::Unwrap(js_buffer);
+  WordCorpus::BufferId id = word_corpus.add_buffer(&text_buffer_wrapper->text_buffer);
+  js_buffers[id] = Napi::Persistent(js_buffer);
+}
+
+Napi::Value WordCorpusWrapper::remove_buffer(const CallbackInfo &info) {
+  auto id = buffer_id_for_js(info[0]);
+  if (!id) return Boolean::New(info.Env(), false);
+
+  word_corpus.remove_buffer(*id);
+  js_buffers.erase(*id);
+  return Boolean::New(info.Env(), true);
+}
+
+Napi::Value WordCorpusWrapper::get_buffer_count(const CallbackInfo &info) {
+  return Number::New(info.Env(), word_corpus.buffer_count());
+}
+
+void WordCorpusWrapper::find_words_with_subsequence(const CallbackInfo &info) {
+  class FindWordsWithSubsequenceWorker : public Napi::AsyncWorker {
+    Napi::ObjectReference corpus;
+    vector<pair<WordCorpus::BufferId, Napi::ObjectReference>> buffers;
+    WordCorpus::Snapshot *snapshot;
+    const u16string query;
+    const u16string extra_word_characters;
+    const size_t max_count;
+    vector<WordCorpus::Match> result;
+
+  public:
+    FindWordsWithSubsequenceWorker(Object corpus,
+                                   Function &completion_callback,
+                                   const u16string query,
+                                   const u16string extra_word_characters,
+                                   const size_t max_count) :
+      AsyncWorker(completion_callback, "WordCorpus.findWordsWithSubsequence"),
+      query{query},
+      extra_word_characters{extra_word_characters},
+      max_count{max_count} {
+      this->corpus.Reset(corpus, 1);
+
+      // Hold on to the buffers themselves, since they may be removed from
+      // the corpus before this worker is done with their snapshots.
+      WordCorpusWrapper *word_corpus_wrapper = WordCorpusWrapper::Unwrap(corpus);
+      for (const auto &entry : word_corpus_wrapper->js_buffers) {
+        buffers.push_back({entry.first, Napi::Persistent(entry.second.Value())});
+      }
+      snapshot = word_corpus_wrapper->word_corpus.create_snapshot();
+    }
+
+    ~FindWordsWithSubsequenceWorker() {
+      if (snapshot) {
+        delete snapshot;
+        snapshot = nullptr;
+      }
+    }
+
+    void Execute() override {
+      result = snapshot->find_words_with_subsequence(query, extra_word_characters, max_count);
+    }
+
+    void OnOK() override {
+      auto env = Env();
+      delete snapshot;
+      snapshot = nullptr;
+
+      Array js_matches = Array::New(env, result.size());
+      for (size_t i = 0; i < result.size(); i++) {
+        const WordCorpus::Match &match = result[i];
+
+        Array js_match_indices = Array::New(env, match.match_indices.size());
+        for (size_t j = 0; j < match.match_indices.size(); j++) {
+          js_match_indices[j] = Number::New(env, match.match_indices[j]);
+        }
+
+        Array js_positions_by_buffer = Array::New(env, match.positions.size());
+        for (size_t j = 0; j < match.positions.size(); j++) {
+          const auto &buffer_positions = match.positions[j];
+          Array js_positions = Array::New(env, buffer_positions.second.size());
+          for (size_t k = 0; k < buffer_positions.second.size(); k++) {
+            js_positions[k] = PointWrapper::from_point(env, buffer_positions.second[k]);
+          }
+
+          Object js_buffer_positions = Object::New(env);
+          for (const auto &buffer : buffers) {
+            if (buffer.first == buffer_positions.first) {
+              js_buffer_positions.Set("buffer", buffer.second.Value());
+              break;
+            }
+          }
+          js_buffer_positions.Set("positions", js_positions);
+          js_positions_by_buffer[j] = js_buffer_positions;
+        }
+
+        Object js_match = Object::New(env);
+        js_match.Set("word", string_conversion::string_to_js(env, match.word));
+        js_match.Set("score", Number::New(env, match.score));
+        js_match.Set("matchIndices", js_match_indices);
+        js_match.Set("positions", js_positions_by_buffer);
+        js_matches[i] = js_match;
+      }
+
+      Callback().Call({js_matches});
+    }
+  };
+
+  auto query = string_conversion::string_from_js(info[0]);
+  auto extra_word_characters = string_conversion::string_from_js(info[1]);
+  auto max_count = number_conversion::number_from_js<uint32_t>(info[2]);
+  Function callback = info[3].As<Function>();
+
+  if (query && extra_word_characters && max_count && callback) {
+    auto worker = new FindWordsWithSubsequenceWorker(
+      info.This().As<Object>(),
+      callback,
+      *query,
+      *extra_word_characters,
+      *max_count
+    );
+    worker->Queue();
+  } else {
+    Napi::Error::New(Env(), "Invalid arguments").ThrowAsJavaScriptException();
+  }
+}
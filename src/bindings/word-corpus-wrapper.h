@@ -0,0 +1,27 @@
+#ifndef SUPERSTRING_WORD_CORPUS_WRAPPER_H
+#define SUPERSTRING_WORD_CORPUS_WRAPPER_H
+
+#include <unordered_map>
+
+#include "napi.h"
+#include "optional.h"
+#include "word-corpus.h"
+
+class WordCorpusWrapper : public Napi::ObjectWrap<WordCorpusWrapper> {
+public:
+  static void init(Napi::Env env, Napi::Object exports);
+
+  explicit WordCorpusWrapper(const Napi::CallbackInfo &info);
+
+private:
+  optional<WordCorpus::BufferId> buffer_id_for_js(Napi::Value);
+  void add_buffer(const Napi::CallbackInfo &info);
+  Napi::Value remove_buffer(const Napi::CallbackInfo &info);
+  Napi::Value get_buffer_count(const Napi::CallbackInfo &info);
+  void find_words_with_subsequence(const Napi::CallbackInfo &info);
+
+  WordCorpus word_corpus;
+  std::unordered_map<WordCorpus::BufferId, Napi::ObjectReference> js_buffers;
+};
+
+#endif // SUPERSTRING_WORD_CORPUS_WRAPPER_H
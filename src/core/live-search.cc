@@ -0,0 +1,124 @@
+#include "live-search.h"
+#include <algorithm>
+
+using std::vector;
+using Match = LiveSearch::Match;
+
+static bool is_before(const Match &a, const Match &b) {
+  return a.range.start < b.range.start || (a.range.start == b.range.start && a.range.end < b.range.end);
+}
+
+bool LiveSearch::Match::operator==(const Match &other) const {
+  return id == other.id && range == other.range;
+}
+
+LiveSearch::LiveSearch(const TextBuffer &buffer, Regex &&regex, uint32_t lookbehind_rows, uint32_t lookahead_rows) :
+  buffer{buffer},
+  regex{std::move(regex)},
+  lookbehind_rows{lookbehind_rows},
+  lookahead_rows{lookahead_rows},
+  next_id{0} {
+  count = buffer.find_and_mark_all(marker_index, next_id, false, this->regex);
+  next_id += count;
+}
+
+vector<Match> LiveSearch::matches() const {
+  vector<Match> result;
+  result.reserve(count);
+  for (const auto &entry : marker_index.dump()) {
+    result.push_back(Match{entry.first, entry.second});
+  }
+  std::sort(result.begin(), result.end(), is_before);
+  return result;
+}
+
+size_t LiveSearch::match_count() const {
+  return count;
+}
+
+LiveSearch::Changes LiveSearch::splice(Point start, Point deleted_extent, Point inserted_extent) {
+  Point deleted_end = start.traverse(deleted_extent);
+  Point inserted_end = start.traverse(inserted_extent);
+
+  // Find the region that needs to be searched again: the rows around the
+  // edit, widened to cover every match that touches it, and rounded out to
+  // whole rows so that anchors and lookbehinds see the same context as a
+  // search of the whole buffer. Matches that start right at the end of the
+  // region are not affected, since the search of the region stops there.
+  Point region_start(start.row > lookbehind_rows ? start.row - lookbehind_rows : 0, 0);
+  Point region_end = Point(deleted_end.row, 0).traverse(Point(lookahead_rows + 1, 0));
+  vector<Match> old_matches;
+  while (true) {
+    old_matches.clear();
+    Point new_region_start = region_start;
+    Point new_region_end = region_end;
+    for (MatchId id : marker_index.find_intersecting(region_start, region_end)) {
+      Range range = marker_index.get_range(id);
+      if (range.end < region_start || range.start >= region_end) continue;
+      old_matches.push_back(Match{id, range});
+      new_region_start = Point::min(new_region_start, range.start);
+      new_region_end = Point::max(new_region_end, range.end);
+    }
+    new_region_start.column = 0;
+    if (new_region_end.column > 0) new_region_end = Point(new_region_end.row, 0).traverse(Point(1, 0));
+    if (new_region_start == region_start && new_region_end == region_end) break;
+    region_start = new_region_start;
+    region_end = new_region_end;
+  }
+
+  std::sort(old_matches.begin(), old_matches.end(), is_before);
+  for (const Match &match : old_matches) {
+    marker_index.remove(match.id);
+  }
+  marker_index.splice(start, deleted_extent, inserted_extent);
+
+  // Old matches that lie entirely before or after the edit can be carried
+  // over to the new text. If the search finds them again, they keep their
+  // ids and aren't reported as changes.
+  vector<Match> carried_matches;
+  for (const Match &match : old_matches) {
+    if (match.range.end <= start) {
+      carried_matches.push_back(match);
+    } else if (match.range.start >= deleted_end) {
+      carried_matches.push_back(Match{match.id, Range{
+        inserted_end.traverse(match.range.start.traversal(deleted_end)),
+        inserted_end.traverse(match.range.end.traversal(deleted_end))
+      }});
+    }
+  }
+
+  Changes changes;
+  vector<MatchId> kept_ids;
+  auto carried_match = carried_matches.begin();
+  region_end = inserted_end.traverse(region_end.traversal(deleted_end));
+  buffer.find_each(regex, [&](Range range) {
+    if (range.start >= region_end) return true;
+    while (carried_match != carried_matches.end() && carried_match->range.start < range.start) {
+      ++carried_match;
+    }
+    if (carried_match != carried_matches.end() && carried_match->range == range) {
+      marker_index.insert(carried_match->id, range.start, range.end);
+      kept_ids.push_back(carried_match->id);
+      ++carried_match;
+    } else {
+      marker_index.insert(next_id, range.start, range.end);
+      changes.added.push_back(Match{next_id, range});
+      next_id++;
+    }
+    return false;
+  }, Range{region_start, region_end});
+
+  // The kept matches are in the same order as the old ones.
+  auto kept_id = kept_ids.begin();
+  for (const Match &match : old_matches) {
+    if (kept_id != kept_ids.end() && *kept_id == match.id) {
+      ++kept_id;
+    } else {
+      changes.removed.push_back(match.id);
+    }
+  }
+
+  count += changes.added.size();
+  count -= changes.removed.size();
+  return changes;
+}
@@ -0,0 +1,56 @@
+#ifndef SUPERSTRING_LIVE_SEARCH_H_
+#define SUPERSTRING_LIVE_SEARCH_H_
+
+#include <vector>
+#include "marker-index.h"
+#include "point.h"
+#include "range.h"
+#include "regex.h"
+#include "text-buffer.h"
+
+// The matches of a regex in a buffer, kept up to date as the buffer changes.
+// The matches are stored as markers, so that an edit only shifts the matches
+// after it, and only the rows around the edit need to be searched again.
+//
+// A match can depend on text outside of the rows it spans, for example by
+// matching a line ending or by looking ahead or behind. `lookbehind_rows` and
+// `lookahead_rows` are the number of rows before and after an edit that may
+// hold matches that it changes.
+class LiveSearch {
+public:
+  using MatchId = MarkerIndex::MarkerId;
+
+  struct Match {
+    MatchId id;
+    Range range;
+    bool operator==(const Match &) const;
+  };
+
+  struct Changes {
+    std::vector<MatchId> removed;
+    std::vector<Match> added;
+  };
+
+  LiveSearch(const TextBuffer &, Regex &&, uint32_t lookbehind_rows = 0, uint32_t lookahead_rows = 0);
+
+  // Returns the current matches in document order.
+  std::vector<Match> matches() const;
+  size_t match_count() const;
+
+  // Updates the matches after the buffer's text in the range starting at
+  // `start` with `deleted_extent` was replaced with text of `inserted_extent`.
+  // Matches that end up unchanged keep their ids. The ids of removed matches
+  // are returned along with the matches that were added in their place.
+  Changes splice(Point start, Point deleted_extent, Point inserted_extent);
+
+private:
+  const TextBuffer &buffer;
+  Regex regex;
+  uint32_t lookbehind_rows;
+  uint32_t lookahead_rows;
+  mutable MarkerIndex marker_index;
+  MatchId next_id;
+  size_t count;
+};
+
+#endif // SUPERSTRING_LIVE_SEARCH_H_
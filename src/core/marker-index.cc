@@ -1,4 +1,6 @@
 #include "marker-index.h"
+#include <assert.h>
+#include <algorithm>
 #include <climits>
 #include <iterator>
 #include <random>
@@ -6,14 +8,24 @@
 #include "range.h"
 
 using std::default_random_engine;
+using std::pair;
 using std::unordered_map;
-
-MarkerIndex::Node::Node(Node *parent, Point left_extent) :
-  parent{parent},
-  left{nullptr},
-  right{nullptr},
-  left_extent{left_extent},
-  priority{0} {}
+using std::vector;
+
+static const size_t MAX_NODE_POSITION_CACHE_WATERMARKS = 32;
+
+void MarkerIndex::Node::reset(Node *parent, Point left_extent) {
+  this->parent = parent;
+  this->left = nullptr;
+  this->right = nullptr;
+  this->left_extent = left_extent;
+  this->priority = 0;
+  this->cached_position_generation = 0;
+  left_marker_ids = MarkerIdSet();
+  right_marker_ids = MarkerIdSet();
+  start_marker_ids = MarkerIdSet();
+  end_marker_ids = MarkerIdSet();
+}
 
 bool MarkerIndex::Node::is_marker_endpoint() {
   return (start_marker_ids.size() + end_marker_ids.size()) > 0;
@@ -38,7 +50,7 @@ MarkerIndex::Node *MarkerIndex::Iterator::insert_marker_start(const MarkerId &id
   reset();
 
   if (!current_node) {
-    return marker_index->root = new Node(nullptr, start_position);
+    return marker_index->root = marker_index->node_pool.allocate(nullptr, start_position);
   }
 
   while (true) {
@@ -75,7 +87,7 @@ MarkerIndex::Node *MarkerIndex::Iterator::insert_marker_end(const MarkerId &id,
   reset();
 
   if (!current_node) {
-    return marker_index->root = new Node(nullptr, end_position);
+    return marker_index->root = marker_index->node_pool.allocate(nullptr, end_position);
   }
 
   while (true) {
@@ -173,7 +185,7 @@ void MarkerIndex::Iterator::find_contained_in(const Point &start, const Point &e
 
   MarkerIdSet started;
   while (current_node && current_node_position <= end) {
-    started.insert(current_node->start_marker_ids.begin(), current_node->start_marker_ids.end());
+    started.insert(current_node->start_marker_ids);
     for (MarkerId id : current_node->end_marker_ids) {
       if (started.count(id) > 0) result->insert(id);
     }
@@ -190,7 +202,7 @@ void MarkerIndex::Iterator::find_starting_in(const Point &start, const Point &en
   seek_to_first_node_greater_than_or_equal_to(start);
 
   while (current_node && current_node_position <= end) {
-    result->insert(current_node->start_marker_ids.begin(), current_node->start_marker_ids.end());
+    result->insert(current_node->start_marker_ids);
     cache_node_position();
     move_to_successor();
   }
@@ -204,13 +216,30 @@ void MarkerIndex::Iterator::find_ending_in(const Point &start, const Point &end,
   seek_to_first_node_greater_than_or_equal_to(start);
 
   while (current_node && current_node_position <= end) {
-    result->insert(current_node->end_marker_ids.begin(), current_node->end_marker_ids.end());
+    result->insert(current_node->end_marker_ids);
     cache_node_position();
     move_to_successor();
   }
 }
 
 void MarkerIndex::Iterator::find_boundaries_after(Point start, size_t max_count, MarkerIndex::BoundaryQueryResult *result) {
+  seek_to_boundary(start, &result->containing_start);
+  while (current_node && max_count > 0) {
+    cache_node_position();
+    result->boundaries.push_back({
+      current_node_position,
+      current_node->start_marker_ids,
+      current_node->end_marker_ids
+    });
+    move_to_successor();
+    max_count--;
+  }
+}
+
+// Moves to the first node at or after `start`. If `containing_start` is
+// given, collects the markers that begin before `start` and end at or after
+// it, ordered by their ranges.
+void MarkerIndex::Iterator::seek_to_boundary(Point start, std::vector<MarkerId> *containing_start) {
   reset();
   if (!current_node) return;
 
@@ -218,9 +247,9 @@ void MarkerIndex::Iterator::find_boundaries_after(Point start, size_t max_count,
     cache_node_position();
 
     if (start <= current_node_position) {
-      if (left_ancestor_position < start) {
-        result->containing_start.insert(
-          result->containing_start.end(),
+      if (containing_start && left_ancestor_position < start) {
+        containing_start->insert(
+          containing_start->end(),
           current_node->left_marker_ids.begin(),
           current_node->left_marker_ids.end()
         );
@@ -232,9 +261,9 @@ void MarkerIndex::Iterator::find_boundaries_after(Point start, size_t max_count,
         break;
       }
     } else {
-      if (right_ancestor_position >= start) {
-        result->containing_start.insert(
-          result->containing_start.end(),
+      if (containing_start && right_ancestor_position >= start) {
+        containing_start->insert(
+          containing_start->end(),
           current_node->right_marker_ids.begin(),
           current_node->right_marker_ids.end()
         );
@@ -247,25 +276,80 @@ void MarkerIndex::Iterator::find_boundaries_after(Point start, size_t max_count,
       }
     }
   }
-  std::sort(
-    result->containing_start.begin(),
-    result->containing_start.end(),
-    [this](MarkerId a, MarkerId b) {
-      int comparison = marker_index->compare(a, b);
-      return comparison == 0 ? a < b : comparison == -1;
-    }
-  );
+  if (containing_start) {
+    std::sort(
+      containing_start->begin(),
+      containing_start->end(),
+      [this](MarkerId a, MarkerId b) {
+        int comparison = marker_index->compare(a, b);
+        return comparison == 0 ? a < b : comparison == -1;
+      }
+    );
+  }
 
   if (current_node_position < start) move_to_successor();
-  while (current_node && max_count > 0) {
+}
+
+void MarkerIndex::Iterator::seek_past_boundary(Point position) {
+  reset();
+  if (!current_node) return;
+
+  seek_to_first_node_greater_than_or_equal_to(position);
+  if (current_node && current_node_position == position) move_to_successor();
+}
+
+size_t MarkerIndex::Iterator::append_packed_boundaries(size_t max_count, PackedBoundaries *result) {
+  size_t count = 0;
+  while (current_node && count < max_count) {
     cache_node_position();
-    result->boundaries.push_back({
-      current_node_position,
-      current_node->start_marker_ids,
-      current_node->end_marker_ids
-    });
+    const MarkerIdSet &starting = current_node->start_marker_ids;
+    const MarkerIdSet &ending = current_node->end_marker_ids;
+    result->positions.push_back(current_node_position);
+    result->id_counts.push_back(starting.size());
+    result->id_counts.push_back(ending.size());
+
+    size_t offset = result->ids.size();
+    result->ids.resize(offset + starting.size() + ending.size());
+    starting.copy_to(result->ids.data() + offset);
+    ending.copy_to(result->ids.data() + offset + starting.size());
+
     move_to_successor();
-    max_count--;
+    count++;
+  }
+  return count;
+}
+
+// Collects up to `count` markers that start after `position`, ordered by
+// their start positions. Only the nodes between `position` and the last
+// result are visited.
+void MarkerIndex::Iterator::find_next_starting_after(Point position, size_t count, LayerMask mask, vector<MarkerId> *result) {
+  seek_past_boundary(position);
+  while (current_node && result->size() < count) {
+    for (MarkerId id : current_node->start_marker_ids) {
+      if (!marker_index->is_in_layers(id, mask)) continue;
+      result->push_back(id);
+      if (result->size() == count) break;
+    }
+    cache_node_position();
+    move_to_successor();
+  }
+}
+
+// Collects up to `count` markers that end before `position`, ordered by their
+// end positions from the nearest to the farthest.
+void MarkerIndex::Iterator::find_previous_ending_before(Point position, size_t count, LayerMask mask, vector<MarkerId> *result) {
+  reset();
+  if (!current_node) return;
+
+  seek_to_last_node_less_than(position);
+  while (current_node && result->size() < count) {
+    for (MarkerId id : current_node->end_marker_ids) {
+      if (!marker_index->is_in_layers(id, mask)) continue;
+      result->push_back(id);
+      if (result->size() == count) break;
+    }
+    cache_node_position();
+    move_to_predecessor();
   }
 }
 
@@ -299,6 +383,42 @@ unordered_map<MarkerIndex::MarkerId, Range> MarkerIndex::Iterator::dump() {
   return snapshot;
 }
 
+// Appends an entry for every marker, ordered by start position, along with
+// the end positions ordered by marker id.
+void MarkerIndex::Iterator::dump_in_order(Snapshot *result) {
+  reset();
+  if (!current_node) return;
+
+  while (current_node->left) {
+    cache_node_position();
+    descend_left();
+  }
+
+  vector<pair<MarkerId, Point>> end_positions;
+  while (current_node) {
+    for (MarkerId id : current_node->start_marker_ids) {
+      result->entries.push_back({Range{current_node_position, current_node_position}, id});
+    }
+    for (MarkerId id : current_node->end_marker_ids) {
+      end_positions.push_back({id, current_node_position});
+    }
+    cache_node_position();
+    move_to_successor();
+  }
+
+  result->entry_indices_by_id.reserve(result->entries.size());
+  for (uint32_t i = 0; i < result->entries.size(); i++) {
+    result->entry_indices_by_id.push_back({result->entries[i].id, i});
+  }
+  std::sort(result->entry_indices_by_id.begin(), result->entry_indices_by_id.end());
+  std::sort(end_positions.begin(), end_positions.end(), [](const pair<MarkerId, Point> &a, const pair<MarkerId, Point> &b) {
+    return a.first < b.first;
+  });
+  for (size_t i = 0; i < end_positions.size(); i++) {
+    result->entries[result->entry_indices_by_id[i].second].range.end = end_positions[i].second;
+  }
+}
+
 void MarkerIndex::Iterator::ascend() {
   if (current_node->parent) {
     if (current_node->parent->left == current_node) {
@@ -353,6 +473,22 @@ void MarkerIndex::Iterator::move_to_successor() {
   }
 }
 
+void MarkerIndex::Iterator::move_to_predecessor() {
+  if (!current_node) return;
+
+  if (current_node->left) {
+    descend_left();
+    while (current_node->right) {
+      descend_right();
+    }
+  } else {
+    while (current_node->parent && current_node->parent->left == current_node) {
+      ascend();
+    }
+    ascend();
+  }
+}
+
 void MarkerIndex::Iterator::seek_to_first_node_greater_than_or_equal_to(const Point &position) {
   while (true) {
     cache_node_position();
@@ -376,6 +512,27 @@ void MarkerIndex::Iterator::seek_to_first_node_greater_than_or_equal_to(const Po
   if (current_node_position < position) move_to_successor();
 }
 
+void MarkerIndex::Iterator::seek_to_last_node_less_than(const Point &position) {
+  while (true) {
+    cache_node_position();
+    if (current_node_position < position) {
+      if (current_node->right) {
+        descend_right();
+      } else {
+        break;
+      }
+    } else {
+      if (current_node->left) {
+        descend_left();
+      } else {
+        break;
+      }
+    }
+  }
+
+  if (current_node_position >= position) move_to_predecessor();
+}
+
 void MarkerIndex::Iterator::mark_right(const MarkerId &id, const Point &start_position, const Point &end_position) {
   if (left_ancestor_position < start_position
     && start_position <= current_node_position
@@ -391,52 +548,54 @@ void MarkerIndex::Iterator::mark_left(const MarkerId &id, const Point &start_pos
 }
 
 MarkerIndex::Node *MarkerIndex::Iterator::insert_left_child(const Point &position) {
-  return current_node->left = new Node(current_node, position.traversal(left_ancestor_position));
+  return current_node->left = marker_index->node_pool.allocate(current_node, position.traversal(left_ancestor_position));
 }
 
 MarkerIndex::Node *MarkerIndex::Iterator::insert_right_child(const Point &position) {
-  return current_node->right = new Node(current_node, position.traversal(current_node_position));
+  return current_node->right = marker_index->node_pool.allocate(current_node, position.traversal(current_node_position));
 }
 
 void MarkerIndex::Iterator::check_intersection(const Point &start, const Point &end, MarkerIdSet *result) {
   if (left_ancestor_position <= end && start <= current_node_position) {
-    result->insert(current_node->left_marker_ids.begin(), current_node->left_marker_ids.end());
+    result->insert(current_node->left_marker_ids);
   }
 
   if (start <= current_node_position && current_node_position <= end) {
-    result->insert(current_node->start_marker_ids.begin(), current_node->start_marker_ids.end());
-    result->insert(current_node->end_marker_ids.begin(), current_node->end_marker_ids.end());
+    result->insert(current_node->start_marker_ids);
+    result->insert(current_node->end_marker_ids);
   }
 
   if (current_node_position <= end && start <= right_ancestor_position) {
-    result->insert(current_node->right_marker_ids.begin(), current_node->right_marker_ids.end());
+    result->insert(current_node->right_marker_ids);
   }
 }
 
 void MarkerIndex::Iterator::cache_node_position() const {
-  marker_index->node_position_cache.insert({current_node, current_node_position});
+  if (current_node) marker_index->cache_node_position(current_node, current_node_position);
 }
 
 MarkerIndex::MarkerIndex(unsigned seed)
   : random_engine{static_cast<default_random_engine::result_type>(seed)},
     random_distribution{1, INT_MAX - 1},
     root{nullptr},
-    iterator{this} {}
+    iterator{this},
+    version{0},
+    node_position_cache_generation{1},
+    node_position_cache_base_generation{1} {}
 
-MarkerIndex::~MarkerIndex() {
-  if (root) delete_subtree(root);
-}
+MarkerIndex::~MarkerIndex() {}
 
 int MarkerIndex::generate_random_number() {
   return random_distribution(random_engine);
 }
 
 void MarkerIndex::insert(MarkerId id, Point start, Point end) {
+  version++;
   Node *start_node = iterator.insert_marker_start(id, start, end);
   Node *end_node = iterator.insert_marker_end(id, start, end);
 
-  node_position_cache.insert({start_node, start});
-  node_position_cache.insert({end_node, end});
+  cache_node_position(start_node, start);
+  cache_node_position(end_node, end);
 
   start_node->start_marker_ids.insert(id);
   end_node->end_marker_ids.insert(id);
@@ -451,8 +610,40 @@ void MarkerIndex::insert(MarkerId id, Point start, Point end) {
     bubble_node_up(end_node);
   }
 
-  start_nodes_by_id.insert({id, start_node});
-  end_nodes_by_id.insert({id, end_node});
+  node_table.insert(id, {start_node->index, end_node->index});
+}
+
+// Inserting markers one at a time costs two descents and a couple of
+// rotations each. When the batch is large relative to the index, it is
+// cheaper to rebuild the whole tree from the sorted endpoints. The given ids
+// must not already be present in the index.
+void MarkerIndex::insert_many(const vector<MarkerId> &ids, const vector<Range> &ranges) {
+  size_t count = std::min(ids.size(), ranges.size());
+  if (count == 0) return;
+
+  // The ids must be new. Rebuilding the tree with an id that is already in
+  // it would leave two pairs of nodes claiming the same marker.
+  for (size_t i = 0; i < count; i++) {
+    assert(!has(ids[i]));
+  }
+
+  if (count < node_table.size() / 4) {
+    for (size_t i = 0; i < count; i++) {
+      insert(ids[i], ranges[i].start, ranges[i].end);
+    }
+    return;
+  }
+
+  vector<pair<MarkerId, Range>> markers;
+  markers.reserve(node_table.size() + count);
+  if (root) {
+    for (auto &entry : dump()) markers.push_back(entry);
+  }
+  for (size_t i = 0; i < count; i++) {
+    markers.push_back({ids[i], ranges[i]});
+  }
+
+  build_tree(markers);
 }
 
 void MarkerIndex::set_exclusive(MarkerId id, bool exclusive) {
@@ -463,9 +654,57 @@ void MarkerIndex::set_exclusive(MarkerId id, bool exclusive) {
   }
 }
 
+// Markers from different layers (selections, search results, diagnostics and
+// so on) can share one index, so that each edit is spliced into a single tree.
+// Every marker starts out in layer 0. Only the ids in other layers are stored,
+// and only for markers that are in the index.
+void MarkerIndex::set_layer(MarkerId id, LayerId layer) {
+  if (!node_table.find(id)) return;
+
+  LayerId current_layer = get_layer(id);
+  if (layer == current_layer || layer >= MAX_LAYER_COUNT) return;
+
+  if (current_layer != 0) layer_marker_ids[current_layer].erase(id);
+  if (layer != 0) {
+    if (layer_marker_ids.size() <= layer) layer_marker_ids.resize(layer + 1);
+    layer_marker_ids[layer].insert(id);
+  }
+}
+
+MarkerIndex::LayerId MarkerIndex::get_layer(MarkerId id) const {
+  for (LayerId layer = 1; layer < layer_marker_ids.size(); layer++) {
+    if (layer_marker_ids[layer].count(id)) return layer;
+  }
+  return 0;
+}
+
+// Keeps the ids whose layer has its bit set in `mask`.
+MarkerIndex::MarkerIdSet MarkerIndex::filter_by_layers(const MarkerIdSet &ids, LayerMask mask) const {
+  if (mask & 1) {
+    MarkerIdSet result = ids;
+    for (LayerId layer = 1; layer < layer_marker_ids.size(); layer++) {
+      if (!(mask & (1u << layer))) result.erase(layer_marker_ids[layer]);
+    }
+    return result;
+  } else {
+    MarkerIdSet layer_ids;
+    for (LayerId layer = 1; layer < layer_marker_ids.size(); layer++) {
+      if (mask & (1u << layer)) layer_ids.insert(layer_marker_ids[layer]);
+    }
+    return ids.intersection(layer_ids);
+  }
+}
+
+bool MarkerIndex::is_in_layers(MarkerId id, LayerMask mask) const {
+  return mask == ALL_LAYERS || (mask & (1u << get_layer(id)));
+}
+
 void MarkerIndex::remove(MarkerId id) {
-  Node *start_node = start_nodes_by_id.find(id)->second;
-  Node *end_node = end_nodes_by_id.find(id)->second;
+  Node *start_node = start_node_for(id);
+  Node *end_node = end_node_for(id);
+  if (!start_node) return;
+
+  version++;
 
   Node *node = start_node;
   while (node) {
@@ -490,17 +729,41 @@ void MarkerIndex::remove(MarkerId id) {
     delete_node(end_node);
   }
 
-  start_nodes_by_id.erase(id);
-  end_nodes_by_id.erase(id);
+  LayerId layer = get_layer(id);
+  if (layer != 0) layer_marker_ids[layer].erase(id);
+  node_table.erase(id);
 }
 
 bool MarkerIndex::has(MarkerId id) {
-  return start_nodes_by_id.count(id) > 0;
+  return node_table.find(id) != nullptr;
 }
 
 MarkerIndex::SpliceResult MarkerIndex::splice(Point start, Point old_extent, Point new_extent) {
-  node_position_cache.clear();
+  invalidate_node_positions_from(start);
+  return apply_splice(start, old_extent, new_extent);
+}
+
+// Applies several splices at once, as when typing with multiple cursors. The
+// splices must be sorted and must not overlap, with every position expressed
+// in the coordinates that precede the whole batch. They are applied from last
+// to first so that the positions of the remaining splices stay valid, and the
+// markers invalidated by any of them are merged into a single result.
+MarkerIndex::SpliceResult MarkerIndex::splice_many(const vector<Splice> &splices) {
+  if (!splices.empty()) invalidate_node_positions_from(splices.front().start);
+
+  SpliceResult invalidated;
+  for (auto splice = splices.rbegin(); splice != splices.rend(); ++splice) {
+    SpliceResult splice_invalidated = apply_splice(splice->start, splice->old_extent, splice->new_extent);
+    invalidated.touch.insert(splice_invalidated.touch);
+    invalidated.inside.insert(splice_invalidated.inside);
+    invalidated.overlap.insert(splice_invalidated.overlap);
+    invalidated.surround.insert(splice_invalidated.surround);
+  }
+  return invalidated;
+}
 
+MarkerIndex::SpliceResult MarkerIndex::apply_splice(Point start, Point old_extent, Point new_extent) {
+  version++;
   SpliceResult invalidated;
 
   if (!root || (old_extent.is_zero() && new_extent.is_zero())) return invalidated;
@@ -524,7 +787,7 @@ MarkerIndex::SpliceResult MarkerIndex::splice(Point start, Point old_extent, Poi
         iter = start_node->start_marker_ids.erase(iter);
         start_node->right_marker_ids.erase(id);
         end_node->start_marker_ids.insert(id);
-        start_nodes_by_id[id] = end_node;
+        node_table.find(id)->start_node = end_node->index;
       } else {
         ++iter;
       }
@@ -537,7 +800,7 @@ MarkerIndex::SpliceResult MarkerIndex::splice(Point start, Point old_extent, Poi
           start_node->right_marker_ids.insert(id);
         }
         end_node->end_marker_ids.insert(id);
-        end_nodes_by_id[id] = end_node;
+        node_table.find(id)->end_node = end_node->index;
       } else {
         ++iter;
       }
@@ -550,7 +813,7 @@ MarkerIndex::SpliceResult MarkerIndex::splice(Point start, Point old_extent, Poi
       if (!starting_inside_splice.count(id)) {
         start_node->right_marker_ids.insert(id);
       }
-      end_nodes_by_id[id] = end_node;
+      node_table.find(id)->end_node = end_node->index;
     }
 
     for (MarkerId id : end_node->end_marker_ids) {
@@ -561,7 +824,7 @@ MarkerIndex::SpliceResult MarkerIndex::splice(Point start, Point old_extent, Poi
 
     for (MarkerId id : starting_inside_splice) {
       end_node->start_marker_ids.insert(id);
-      start_nodes_by_id[id] = end_node;
+      node_table.find(id)->start_node = end_node->index;
     }
 
     for (auto iter = start_node->start_marker_ids.begin(); iter != start_node->start_marker_ids.end();) {
@@ -570,7 +833,7 @@ MarkerIndex::SpliceResult MarkerIndex::splice(Point start, Point old_extent, Poi
         iter = start_node->start_marker_ids.erase(iter);
         start_node->right_marker_ids.erase(id);
         end_node->start_marker_ids.insert(id);
-        start_nodes_by_id[id] = end_node;
+        node_table.find(id)->start_node = end_node->index;
         starting_inside_splice.insert(id);
       } else {
         ++iter;
@@ -591,7 +854,7 @@ MarkerIndex::SpliceResult MarkerIndex::splice(Point start, Point old_extent, Poi
     for (MarkerId id : end_node->start_marker_ids) {
       start_node->start_marker_ids.insert(id);
       start_node->right_marker_ids.insert(id);
-      start_nodes_by_id[id] = start_node;
+      node_table.find(id)->start_node = start_node->index;
     }
 
     for (MarkerId id : end_node->end_marker_ids) {
@@ -600,7 +863,7 @@ MarkerIndex::SpliceResult MarkerIndex::splice(Point start, Point old_extent, Poi
         start_node->left_marker_ids.insert(id);
         end_node->left_marker_ids.erase(id);
       }
-      end_nodes_by_id[id] = start_node;
+      node_table.find(id)->end_node = start_node->index;
     }
     delete_node(end_node);
   } else if (end_node->is_marker_endpoint()) {
@@ -621,19 +884,19 @@ MarkerIndex::SpliceResult MarkerIndex::splice(Point start, Point old_extent, Poi
 }
 
 Point MarkerIndex::get_start(MarkerId id) const {
-  auto result = start_nodes_by_id.find(id);
-  if (result == start_nodes_by_id.end())
+  const Node *node = start_node_for(id);
+  if (!node)
     return Point();
   else
-    return get_node_position(result->second);
+    return get_node_position(node);
 }
 
 Point MarkerIndex::get_end(MarkerId id) const {
-  auto result = end_nodes_by_id.find(id);
-  if (result == end_nodes_by_id.end())
+  const Node *node = end_node_for(id);
+  if (!node)
     return Point();
   else
-    return get_node_position(result->second);
+    return get_node_position(node);
 }
 
 Range MarkerIndex::get_range(MarkerId id) const {
@@ -651,13 +914,13 @@ int MarkerIndex::compare(MarkerId id1, MarkerId id2) const {
   }
 }
 
-flat_set<MarkerIndex::MarkerId> MarkerIndex::find_intersecting(Point start, Point end) {
+MarkerIndex::MarkerIdSet MarkerIndex::find_intersecting(Point start, Point end) {
   MarkerIdSet result;
   iterator.find_intersecting(start, end, &result);
   return result;
 }
 
-flat_set<MarkerIndex::MarkerId> MarkerIndex::find_containing(Point start, Point end) {
+MarkerIndex::MarkerIdSet MarkerIndex::find_containing(Point start, Point end) {
   MarkerIdSet containing_start;
   iterator.find_intersecting(start, start, &containing_start);
   if (end == start) {
@@ -665,39 +928,33 @@ flat_set<MarkerIndex::MarkerId> MarkerIndex::find_containing(Point start, Point
   } else {
     MarkerIdSet containing_end;
     iterator.find_intersecting(end, end, &containing_end);
-    MarkerIdSet containing_start_and_end;
-    for (MarkerId id : containing_start) {
-      if (containing_end.count(id) > 0) {
-        containing_start_and_end.insert(id);
-      }
-    }
-    return containing_start_and_end;
+    return containing_start.intersection(containing_end);
   }
 }
 
-flat_set<MarkerIndex::MarkerId> MarkerIndex::find_contained_in(Point start, Point end) {
+MarkerIndex::MarkerIdSet MarkerIndex::find_contained_in(Point start, Point end) {
   MarkerIdSet result;
   iterator.find_contained_in(start, end, &result);
   return result;
 }
 
-flat_set<MarkerIndex::MarkerId> MarkerIndex::find_starting_in(Point start, Point end) {
+MarkerIndex::MarkerIdSet MarkerIndex::find_starting_in(Point start, Point end) {
   MarkerIdSet result;
   iterator.find_starting_in(start, end, &result);
   return result;
 }
 
-flat_set<MarkerIndex::MarkerId> MarkerIndex::find_starting_at(Point position) {
+MarkerIndex::MarkerIdSet MarkerIndex::find_starting_at(Point position) {
   return find_starting_in(position, position);
 }
 
-flat_set<MarkerIndex::MarkerId> MarkerIndex::find_ending_in(Point start, Point end) {
+MarkerIndex::MarkerIdSet MarkerIndex::find_ending_in(Point start, Point end) {
   MarkerIdSet result;
   iterator.find_ending_in(start, end, &result);
   return result;
 }
 
-flat_set<MarkerIndex::MarkerId> MarkerIndex::find_ending_at(Point position) {
+MarkerIndex::MarkerIdSet MarkerIndex::find_ending_at(Point position) {
   return find_ending_in(position, position);
 }
 
@@ -707,31 +964,188 @@ MarkerIndex::BoundaryQueryResult MarkerIndex::find_boundaries_after(Point start,
   return result;
 }
 
+// Finds the nearest markers after a position, for jumping to the next search
+// result or diagnostic, optionally restricted to some marker layers.
+vector<MarkerIndex::MarkerId> MarkerIndex::find_next_starting_after(Point position, size_t count, LayerMask mask) {
+  vector<MarkerId> result;
+  iterator.find_next_starting_after(position, count, mask, &result);
+  return result;
+}
+
+vector<MarkerIndex::MarkerId> MarkerIndex::find_previous_ending_before(Point position, size_t count, LayerMask mask) {
+  vector<MarkerId> result;
+  iterator.find_previous_ending_before(position, count, mask, &result);
+  return result;
+}
+
 unordered_map<MarkerIndex::MarkerId, Range> MarkerIndex::dump() {
   return iterator.dump();
 }
 
+MarkerIndex::Snapshot MarkerIndex::create_snapshot() {
+  Snapshot result;
+  iterator.dump_in_order(&result);
+  result.build_index();
+  return result;
+}
+
 Point MarkerIndex::get_node_position(const Node *node) const {
-  auto cache_entry = node_position_cache.find(node);
-  if (cache_entry == node_position_cache.end()) {
-    Point position = node->left_extent;
-    const Node *current_node = node;
-    while (current_node->parent) {
-      if (current_node->parent->right == current_node) {
-        position = current_node->parent->left_extent.traverse(position);
+  unsigned cached_generation = node->cached_position_generation;
+  if (cached_generation >= node_position_cache_base_generation) {
+    if (cached_generation == node_position_cache_generation) return node->cached_position;
+
+    // The oldest watermark written after this entry is the lowest position
+    // that any splice has touched since.
+    auto watermark = std::lower_bound(
+      node_position_cache_watermarks.begin(),
+      node_position_cache_watermarks.end(),
+      cached_generation,
+      [](const pair<unsigned, Point> &watermark, unsigned generation) {
+        return watermark.first < generation;
       }
+    );
+    if (node->cached_position < watermark->second) return node->cached_position;
+  }
 
-      current_node = current_node->parent;
+  Point position = node->left_extent;
+  const Node *current_node = node;
+  while (current_node->parent) {
+    if (current_node->parent->right == current_node) {
+      position = current_node->parent->left_extent.traverse(position);
+    }
+
+    current_node = current_node->parent;
+  }
+  cache_node_position(node, position);
+  return position;
+}
+
+void MarkerIndex::cache_node_position(const Node *node, Point position) const {
+  node->cached_position = position;
+  node->cached_position_generation = node_position_cache_generation;
+}
+
+// Splices don't move anything that precedes them, so rather than clearing the
+// cache, start a new generation and record where the splice began. Cached
+// positions from an older generation remain valid as long as they precede
+// every splice since. The watermarks are kept with increasing generations and
+// increasing positions, so each one holds the lowest splice start over all
+// the generations after it.
+void MarkerIndex::invalidate_node_positions_from(Point position) {
+  while (!node_position_cache_watermarks.empty() && position <= node_position_cache_watermarks.back().second) {
+    node_position_cache_watermarks.pop_back();
+  }
+  node_position_cache_watermarks.push_back({node_position_cache_generation, position});
+  node_position_cache_generation++;
+
+  // Edits that keep moving forward push a watermark each. Rather than letting
+  // the list grow, fold the oldest watermark into the next one, which only
+  // lowers the bound for the entries between them.
+  if (node_position_cache_watermarks.size() > MAX_NODE_POSITION_CACHE_WATERMARKS) {
+    node_position_cache_watermarks[1].second = node_position_cache_watermarks[0].second;
+    node_position_cache_watermarks.erase(node_position_cache_watermarks.begin());
+  }
+}
+
+void MarkerIndex::clear_node_position_cache() {
+  node_position_cache_watermarks.clear();
+  node_position_cache_generation++;
+  node_position_cache_base_generation = node_position_cache_generation;
+}
+
+void MarkerIndex::build_tree(vector<pair<MarkerId, Range>> &markers) {
+  version++;
+  node_pool.clear();
+  root = nullptr;
+  node_table.clear();
+  clear_node_position_cache();
+
+  vector<Point> positions;
+  positions.reserve(markers.size() * 2);
+  for (const auto &marker : markers) {
+    positions.push_back(marker.second.start);
+    positions.push_back(marker.second.end);
+  }
+  auto is_before = [](const Point &a, const Point &b) {
+    return a.row < b.row || (a.row == b.row && a.column < b.column);
+  };
+  std::sort(positions.begin(), positions.end(), is_before);
+  positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+
+  // Build the treap over the sorted endpoints in linear time, keeping the
+  // rightmost path on a stack. A node's left ancestor is the node beneath it
+  // on the stack, and its right ancestor is the node that pops it.
+  const size_t NONE = SIZE_MAX;
+  size_t node_count = positions.size();
+  vector<Node *> nodes(node_count);
+  vector<size_t> parent_indices(node_count, NONE);
+  vector<Point> left_ancestor_positions(node_count, Point(0, 0));
+  vector<Point> right_ancestor_positions(node_count, Point(UINT32_MAX, UINT32_MAX));
+  vector<size_t> rightmost_path;
+  for (size_t i = 0; i < node_count; i++) {
+    Node *node = nodes[i] = node_pool.allocate(nullptr, positions[i]);
+    node->priority = generate_random_number();
+
+    size_t last_popped_index = NONE;
+    while (!rightmost_path.empty() && nodes[rightmost_path.back()]->priority > node->priority) {
+      last_popped_index = rightmost_path.back();
+      right_ancestor_positions[last_popped_index] = positions[i];
+      rightmost_path.pop_back();
+    }
+
+    if (last_popped_index != NONE) {
+      node->left = nodes[last_popped_index];
+      node->left->parent = node;
+      parent_indices[last_popped_index] = i;
+    }
+
+    if (!rightmost_path.empty()) {
+      size_t left_ancestor_index = rightmost_path.back();
+      left_ancestor_positions[i] = positions[left_ancestor_index];
+      node->left_extent = positions[i].traversal(positions[left_ancestor_index]);
+      node->parent = nodes[left_ancestor_index];
+      node->parent->right = node;
+      parent_indices[i] = left_ancestor_index;
+    }
+
+    rightmost_path.push_back(i);
+  }
+  root = nodes[rightmost_path.front()];
+
+  // Visit markers in id order so that every id set is appended to in order.
+  std::sort(markers.begin(), markers.end(), [](const pair<MarkerId, Range> &a, const pair<MarkerId, Range> &b) {
+    return a.first < b.first;
+  });
+
+  // Mark each marker on the same nodes as Iterator::mark_right and
+  // Iterator::mark_left would. Those nodes are ancestors of the endpoint
+  // nodes, and the intervals spanned by ancestors only grow, so each walk
+  // can stop at the first ancestor that the marker no longer covers.
+  for (const auto &marker : markers) {
+    MarkerId id = marker.first;
+    Point start = marker.second.start;
+    Point end = marker.second.end;
+
+    size_t start_index = std::lower_bound(positions.begin(), positions.end(), start, is_before) - positions.begin();
+    nodes[start_index]->start_marker_ids.insert(id);
+    // Iterator::mark_right requires the left ancestor to precede the start,
+    // which never holds for a marker starting at zero.
+    if (!start.is_zero()) {
+      for (size_t i = start_index; i != NONE && right_ancestor_positions[i] <= end; i = parent_indices[i]) {
+        if (start <= positions[i]) nodes[i]->right_marker_ids.insert(id);
+      }
+    }
+
+    size_t end_index = std::lower_bound(positions.begin() + start_index, positions.end(), end, is_before) - positions.begin();
+    nodes[end_index]->end_marker_ids.insert(id);
+    node_table.insert(id, {nodes[start_index]->index, nodes[end_index]->index});
+    for (size_t i = end_index; i != NONE && start <= left_ancestor_positions[i]; i = parent_indices[i]) {
+      if (positions[i] <= end && !positions[i].is_zero()) nodes[i]->left_marker_ids.insert(id);
     }
-    node_position_cache.insert({node, position});
-    return position;
-  } else {
-    return cache_entry->second;
   }
 }
 
 void MarkerIndex::delete_node(Node *node) {
-  node_position_cache.erase(node);
   node->priority = INT_MAX;
 
   bubble_node_down(node);
@@ -746,13 +1160,13 @@ void MarkerIndex::delete_node(Node *node) {
     root = nullptr;
   }
 
-  delete node;
+  node_pool.free(node);
 }
 
 void MarkerIndex::delete_subtree(Node *node) {
   if (node->left) delete_subtree(node->left);
   if (node->right) delete_subtree(node->right);
-  delete node;
+  node_pool.free(node);
 }
 
 void MarkerIndex::bubble_node_up(Node *node) {
@@ -804,17 +1218,13 @@ void MarkerIndex::rotate_node_left(Node *rotation_pivot) {
 
   rotation_pivot->left_extent = rotation_root->left_extent.traverse(rotation_pivot->left_extent);
 
-  rotation_pivot->right_marker_ids.insert(rotation_root->right_marker_ids.begin(), rotation_root->right_marker_ids.end());
+  rotation_pivot->right_marker_ids.insert(rotation_root->right_marker_ids);
 
-  for (auto it = rotation_pivot->left_marker_ids.begin(); it != rotation_pivot->left_marker_ids.end();) {
-    if (rotation_root->left_marker_ids.count(*it)) {
-      rotation_root->left_marker_ids.erase(*it);
-      ++it;
-    } else {
-      rotation_root->right_marker_ids.insert(*it);
-      it = rotation_pivot->left_marker_ids.erase(it);
-    }
-  }
+  MarkerIdSet shared_left_marker_ids = rotation_pivot->left_marker_ids.intersection(rotation_root->left_marker_ids);
+  rotation_root->left_marker_ids.erase(shared_left_marker_ids);
+  rotation_pivot->left_marker_ids.erase(shared_left_marker_ids);
+  rotation_root->right_marker_ids.insert(rotation_pivot->left_marker_ids);
+  rotation_pivot->left_marker_ids = std::move(shared_left_marker_ids);
 }
 
 void MarkerIndex::rotate_node_right(Node *rotation_pivot) {
@@ -841,21 +1251,15 @@ void MarkerIndex::rotate_node_right(Node *rotation_pivot) {
 
   rotation_root->left_extent = rotation_root->left_extent.traversal(rotation_pivot->left_extent);
 
-  for (auto it = rotation_root->left_marker_ids.begin(); it != rotation_root->left_marker_ids.end(); ++it) {
-    if (!rotation_pivot->start_marker_ids.count(*it)) {
-      rotation_pivot->left_marker_ids.insert(*it);
-    }
-  }
+  MarkerIdSet root_left_marker_ids = rotation_root->left_marker_ids;
+  root_left_marker_ids.erase(rotation_pivot->start_marker_ids);
+  rotation_pivot->left_marker_ids.insert(root_left_marker_ids);
 
-  for (auto it = rotation_pivot->right_marker_ids.begin(); it != rotation_pivot->right_marker_ids.end();) {
-    if (rotation_root->right_marker_ids.count(*it)) {
-      rotation_root->right_marker_ids.erase(*it);
-      ++it;
-    } else {
-      rotation_root->left_marker_ids.insert(*it);
-      it = rotation_pivot->right_marker_ids.erase(it);
-    }
-  }
+  MarkerIdSet shared_right_marker_ids = rotation_pivot->right_marker_ids.intersection(rotation_root->right_marker_ids);
+  rotation_root->right_marker_ids.erase(shared_right_marker_ids);
+  rotation_pivot->right_marker_ids.erase(shared_right_marker_ids);
+  rotation_root->left_marker_ids.insert(rotation_pivot->right_marker_ids);
+  rotation_pivot->right_marker_ids = std::move(shared_right_marker_ids);
 }
 
 void MarkerIndex::get_starting_and_ending_markers_within_subtree(const Node *node, MarkerIdSet *starting, MarkerIdSet *ending) {
@@ -864,35 +1268,273 @@ void MarkerIndex::get_starting_and_ending_markers_within_subtree(const Node *nod
   }
 
   get_starting_and_ending_markers_within_subtree(node->left, starting, ending);
-  starting->insert(node->start_marker_ids.begin(), node->start_marker_ids.end());
-  ending->insert(node->end_marker_ids.begin(), node->end_marker_ids.end());
+  starting->insert(node->start_marker_ids);
+  ending->insert(node->end_marker_ids);
   get_starting_and_ending_markers_within_subtree(node->right, starting, ending);
 }
 
 void MarkerIndex::populate_splice_invalidation_sets(SpliceResult *invalidated, const Node *start_node, const Node *end_node, const MarkerIdSet &starting_inside_splice, const MarkerIdSet &ending_inside_splice) {
-  invalidated->touch.insert(start_node->end_marker_ids.begin(), start_node->end_marker_ids.end());
-  invalidated->touch.insert(end_node->start_marker_ids.begin(), end_node->start_marker_ids.end());
+  invalidated->touch.insert(start_node->end_marker_ids);
+  invalidated->touch.insert(end_node->start_marker_ids);
 
-  for (MarkerId id : start_node->right_marker_ids) {
-    invalidated->touch.insert(id);
-    invalidated->inside.insert(id);
+  for (const MarkerIdSet *marker_ids : {&start_node->right_marker_ids, &end_node->left_marker_ids}) {
+    invalidated->touch.insert(*marker_ids);
+    invalidated->inside.insert(*marker_ids);
   }
 
-  for (MarkerId id : end_node->left_marker_ids) {
-    invalidated->touch.insert(id);
-    invalidated->inside.insert(id);
+  for (const MarkerIdSet *marker_ids : {&starting_inside_splice, &ending_inside_splice}) {
+    invalidated->touch.insert(*marker_ids);
+    invalidated->inside.insert(*marker_ids);
+    invalidated->overlap.insert(*marker_ids);
   }
 
-  for (MarkerId id : starting_inside_splice) {
-    invalidated->touch.insert(id);
-    invalidated->inside.insert(id);
-    invalidated->overlap.insert(id);
-    if (ending_inside_splice.count(id)) invalidated->surround.insert(id);
+  invalidated->surround = starting_inside_splice.intersection(ending_inside_splice);
+}
+
+MarkerIndex::BoundaryCursor::BoundaryCursor(MarkerIndex *marker_index) :
+  marker_index{marker_index},
+  iterator{marker_index},
+  version{marker_index->version},
+  resume_past_position{false} {
+  iterator.seek_to_boundary(resume_position, nullptr);
+}
+
+// Moves the cursor to the first boundary at or after `start` and returns the
+// markers that contain `start` without starting there, like
+// `find_boundaries_after`.
+vector<MarkerIndex::MarkerId> MarkerIndex::BoundaryCursor::seek(Point start) {
+  vector<MarkerId> containing_start;
+  iterator.seek_to_boundary(start, &containing_start);
+  version = marker_index->version;
+  resume_position = start;
+  resume_past_position = false;
+  return containing_start;
+}
+
+size_t MarkerIndex::BoundaryCursor::next(size_t max_count, PackedBoundaries *result) {
+  if (version != marker_index->version) {
+    if (resume_past_position) {
+      iterator.seek_past_boundary(resume_position);
+    } else {
+      iterator.seek_to_boundary(resume_position, nullptr);
+    }
+    version = marker_index->version;
+  }
+
+  size_t count = iterator.append_packed_boundaries(max_count, result);
+  if (count > 0) {
+    resume_position = result->positions.back();
+    resume_past_position = true;
   }
+  return count;
+}
 
-  for (MarkerId id : ending_inside_splice) {
-    invalidated->touch.insert(id);
-    invalidated->inside.insert(id);
-    invalidated->overlap.insert(id);
+MarkerIndex::Node *MarkerIndex::NodePool::allocate(Node *parent, Point left_extent) {
+  uint32_t index;
+  if (!free_indices.empty()) {
+    index = free_indices.back();
+    free_indices.pop_back();
+  } else {
+    index = next_index++;
+    if ((index >> CHUNK_SIZE_LOG2) == chunks.size()) {
+      chunks.emplace_back(new Node[CHUNK_SIZE]);
+    }
   }
+
+  Node *node = get(index);
+  node->reset(parent, left_extent);
+  node->index = index;
+  return node;
+}
+
+void MarkerIndex::NodePool::free(Node *node) {
+  node->reset(nullptr, Point());
+  free_indices.push_back(node->index);
+}
+
+void MarkerIndex::NodePool::clear() {
+  chunks.clear();
+  free_indices.clear();
+  next_index = 0;
+}
+
+const MarkerIndex::NodeTable::Entry *MarkerIndex::NodeTable::find(MarkerId id) const {
+  if (id < dense_entries.size()) {
+    const Entry &entry = dense_entries[id];
+    return entry.start_node == NO_NODE ? nullptr : &entry;
+  }
+
+  if (sparse_entries.empty()) return nullptr;
+  auto result = sparse_entries.find(id);
+  return result == sparse_entries.end() ? nullptr : &result->second;
+}
+
+MarkerIndex::NodeTable::Entry *MarkerIndex::NodeTable::find(MarkerId id) {
+  return const_cast<Entry *>(static_cast<const NodeTable *>(this)->find(id));
+}
+
+void MarkerIndex::NodeTable::insert(MarkerId id, Entry entry) {
+  if (!find(id)) count++;
+
+  // Grow the vector to cover the id as long as it stays within a constant
+  // factor of the number of markers.
+  if (id >= dense_entries.size() && id < 2 * count + 1024) {
+    size_t new_size = std::max<size_t>(id + 1, dense_entries.size() * 2);
+    dense_entries.resize(new_size, Entry{NO_NODE, NO_NODE});
+    for (auto iter = sparse_entries.begin(); iter != sparse_entries.end();) {
+      if (iter->first < new_size) {
+        dense_entries[iter->first] = iter->second;
+        iter = sparse_entries.erase(iter);
+      } else {
+        ++iter;
+      }
+    }
+  }
+
+  if (id < dense_entries.size()) {
+    dense_entries[id] = entry;
+  } else {
+    sparse_entries[id] = entry;
+  }
+}
+
+void MarkerIndex::NodeTable::erase(MarkerId id) {
+  if (id < dense_entries.size()) {
+    if (dense_entries[id].start_node == NO_NODE) return;
+    dense_entries[id] = Entry{NO_NODE, NO_NODE};
+    count--;
+  } else if (sparse_entries.erase(id)) {
+    count--;
+  }
+}
+
+void MarkerIndex::NodeTable::clear() {
+  dense_entries.clear();
+  sparse_entries.clear();
+  count = 0;
+}
+
+MarkerIndex::Node *MarkerIndex::start_node_for(MarkerId id) const {
+  const NodeTable::Entry *entry = node_table.find(id);
+  return entry ? node_pool.get(entry->start_node) : nullptr;
+}
+
+MarkerIndex::Node *MarkerIndex::end_node_for(MarkerId id) const {
+  const NodeTable::Entry *entry = node_table.find(id);
+  return entry ? node_pool.get(entry->end_node) : nullptr;
+}
+
+size_t MarkerIndex::Snapshot::size() const {
+  return entries.size();
+}
+
+bool MarkerIndex::Snapshot::has(MarkerId id) const {
+  return find_entry(id) != nullptr;
+}
+
+Point MarkerIndex::Snapshot::get_start(MarkerId id) const {
+  const Entry *entry = find_entry(id);
+  return entry ? entry->range.start : Point();
+}
+
+Point MarkerIndex::Snapshot::get_end(MarkerId id) const {
+  const Entry *entry = find_entry(id);
+  return entry ? entry->range.end : Point();
+}
+
+Range MarkerIndex::Snapshot::get_range(MarkerId id) const {
+  const Entry *entry = find_entry(id);
+  return entry ? entry->range : Range{Point(), Point()};
+}
+
+void MarkerIndex::Snapshot::build_index() {
+  max_ends.resize(entries.size());
+  build_max_ends(0, entries.size());
+}
+
+Point MarkerIndex::Snapshot::build_max_ends(size_t begin, size_t end) {
+  if (begin == end) return Point();
+  size_t middle = begin + (end - begin) / 2;
+  Point max_end = entries[middle].range.end;
+  max_end = std::max(max_end, build_max_ends(begin, middle));
+  max_end = std::max(max_end, build_max_ends(middle + 1, end));
+  return max_ends[middle] = max_end;
+}
+
+const MarkerIndex::Snapshot::Entry *MarkerIndex::Snapshot::find_entry(MarkerId id) const {
+  auto iter = std::lower_bound(
+    entry_indices_by_id.begin(),
+    entry_indices_by_id.end(),
+    pair<MarkerId, uint32_t>(id, 0)
+  );
+  if (iter == entry_indices_by_id.end() || iter->first != id) return nullptr;
+  return &entries[iter->second];
+}
+
+// Collects the indices of the entries that intersect the given range. Any
+// subtree whose entries all end before `start` is skipped, as is the right
+// subtree of any entry that starts after `end_position`.
+void MarkerIndex::Snapshot::collect_intersecting(size_t begin, size_t end, Point start, Point end_position, vector<uint32_t> *result) const {
+  while (begin < end) {
+    size_t middle = begin + (end - begin) / 2;
+    if (max_ends[middle] < start) return;
+    collect_intersecting(begin, middle, start, end_position, result);
+    const Range &range = entries[middle].range;
+    if (end_position < range.start) return;
+    if (start <= range.end) result->push_back(middle);
+    begin = middle + 1;
+  }
+}
+
+template <typename Predicate>
+MarkerIndex::MarkerIdSet MarkerIndex::Snapshot::find_intersecting_where(Point start, Point end, Predicate predicate) const {
+  vector<uint32_t> entry_indices;
+  collect_intersecting(0, entries.size(), start, end, &entry_indices);
+
+  vector<MarkerId> ids;
+  ids.reserve(entry_indices.size());
+  for (uint32_t index : entry_indices) {
+    if (predicate(entries[index])) ids.push_back(entries[index].id);
+  }
+  std::sort(ids.begin(), ids.end());
+
+  MarkerIdSet result;
+  result.insert(ids.begin(), ids.end());
+  return result;
+}
+
+MarkerIndex::MarkerIdSet MarkerIndex::Snapshot::find_intersecting(Point start, Point end) const {
+  return find_intersecting_where(start, end, [](const Entry &) { return true; });
+}
+
+MarkerIndex::MarkerIdSet MarkerIndex::Snapshot::find_containing(Point start, Point end) const {
+  return find_intersecting_where(start, start, [&end](const Entry &entry) {
+    return end <= entry.range.end;
+  });
+}
+
+MarkerIndex::MarkerIdSet MarkerIndex::Snapshot::find_contained_in(Point start, Point end) const {
+  return find_intersecting_where(start, end, [&start, &end](const Entry &entry) {
+    return start <= entry.range.start && entry.range.end <= end;
+  });
+}
+
+MarkerIndex::MarkerIdSet MarkerIndex::Snapshot::find_starting_in(Point start, Point end) const {
+  return find_intersecting_where(start, end, [&start](const Entry &entry) {
+    return start <= entry.range.start;
+  });
+}
+
+MarkerIndex::MarkerIdSet MarkerIndex::Snapshot::find_ending_in(Point start, Point end) const {
+  return find_intersecting_where(start, end, [&end](const Entry &entry) {
+    return entry.range.end <= end;
+  });
+}
+
+unordered_map<MarkerIndex::MarkerId, Range> MarkerIndex::Snapshot::dump() const {
+  unordered_map<MarkerId, Range> result;
+  for (const Entry &entry : entries) {
+    result.insert({entry.id, entry.range});
+  }
+  return result;
 }
@@ -1,28 +1,41 @@
 #ifndef MARKER_INDEX_H_
 #define MARKER_INDEX_H_
 
+#include <cstdint>
+#include <memory>
 #include <random>
 #include <unordered_map>
-#include "flat_set.h"
 #include "point.h"
 #include "range.h"
+#include "run_set.h"
 
 class MarkerIndex {
 public:
   using MarkerId = unsigned;
-  using MarkerIdSet = flat_set<MarkerId>;
+  using MarkerIdSet = run_set<MarkerId>;
+  using LayerId = unsigned;
+  using LayerMask = uint32_t;
+
+  static const LayerId MAX_LAYER_COUNT = 32;
+  static const LayerMask ALL_LAYERS = UINT32_MAX;
 
   struct SpliceResult {
-    flat_set<MarkerId> touch;
-    flat_set<MarkerId> inside;
-    flat_set<MarkerId> overlap;
-    flat_set<MarkerId> surround;
+    MarkerIdSet touch;
+    MarkerIdSet inside;
+    MarkerIdSet overlap;
+    MarkerIdSet surround;
+  };
+
+  struct Splice {
+    Point start;
+    Point old_extent;
+    Point new_extent;
   };
 
   struct Boundary {
     Point position;
-    flat_set<MarkerId> starting;
-    flat_set<MarkerId> ending;
+    MarkerIdSet starting;
+    MarkerIdSet ending;
   };
 
   struct BoundaryQueryResult {
@@ -30,29 +43,49 @@ public:
     std::vector<Boundary> boundaries;
   };
 
+  // Boundaries laid out in flat arrays. For each position, `id_counts` holds
+  // the number of markers starting and the number of markers ending there,
+  // and `ids` holds those starting ids followed by those ending ids.
+  struct PackedBoundaries {
+    std::vector<Point> positions;
+    std::vector<uint32_t> id_counts;
+    std::vector<MarkerId> ids;
+  };
+
+  class BoundaryCursor;
+  class Snapshot;
+
   MarkerIndex(unsigned seed = 0u);
   ~MarkerIndex();
   int generate_random_number();
   void insert(MarkerId id, Point start, Point end);
+  void insert_many(const std::vector<MarkerId> &ids, const std::vector<Range> &ranges);
   void set_exclusive(MarkerId id, bool exclusive);
+  void set_layer(MarkerId id, LayerId layer);
+  LayerId get_layer(MarkerId id) const;
+  MarkerIdSet filter_by_layers(const MarkerIdSet &ids, LayerMask mask) const;
   void remove(MarkerId id);
   bool has(MarkerId id);
   SpliceResult splice(Point start, Point old_extent, Point new_extent);
+  SpliceResult splice_many(const std::vector<Splice> &splices);
   Point get_start(MarkerId id) const;
   Point get_end(MarkerId id) const;
   Range get_range(MarkerId id) const;
 
   int compare(MarkerId id1, MarkerId id2) const;
-  flat_set<MarkerId> find_intersecting(Point start, Point end);
-  flat_set<MarkerId> find_containing(Point start, Point end);
-  flat_set<MarkerId> find_contained_in(Point start, Point end);
-  flat_set<MarkerId> find_starting_in(Point start, Point end);
-  flat_set<MarkerId> find_starting_at(Point position);
-  flat_set<MarkerId> find_ending_in(Point start, Point end);
-  flat_set<MarkerId> find_ending_at(Point position);
+  MarkerIdSet find_intersecting(Point start, Point end);
+  MarkerIdSet find_containing(Point start, Point end);
+  MarkerIdSet find_contained_in(Point start, Point end);
+  MarkerIdSet find_starting_in(Point start, Point end);
+  MarkerIdSet find_starting_at(Point position);
+  MarkerIdSet find_ending_in(Point start, Point end);
+  MarkerIdSet find_ending_at(Point position);
   BoundaryQueryResult find_boundaries_after(Point start, size_t max_count);
+  std::vector<MarkerId> find_next_starting_after(Point position, size_t count, LayerMask mask = ALL_LAYERS);
+  std::vector<MarkerId> find_previous_ending_before(Point position, size_t count, LayerMask mask = ALL_LAYERS);
 
   std::unordered_map<MarkerId, Range> dump();
+  Snapshot create_snapshot();
 
 private:
   friend class Iterator;
@@ -62,16 +95,66 @@ private:
     Node *left;
     Node *right;
     Point left_extent;
-    flat_set<MarkerId> left_marker_ids;
-    flat_set<MarkerId> right_marker_ids;
-    flat_set<MarkerId> start_marker_ids;
-    flat_set<MarkerId> end_marker_ids;
     int priority;
+    uint32_t index;
+    mutable unsigned cached_position_generation;
+    mutable Point cached_position;
+    MarkerIdSet left_marker_ids;
+    MarkerIdSet right_marker_ids;
+    MarkerIdSet start_marker_ids;
+    MarkerIdSet end_marker_ids;
 
-    Node(Node *parent, Point left_extent);
+    void reset(Node *parent, Point left_extent);
     bool is_marker_endpoint();
   };
 
+  // Allocates nodes in fixed-size chunks, so that nodes created together sit
+  // next to each other in memory, and so that a node can be referred to by a
+  // 32-bit index instead of a pointer.
+  class NodePool {
+  public:
+    static const uint32_t CHUNK_SIZE_LOG2 = 10;
+    static const uint32_t CHUNK_SIZE = 1 << CHUNK_SIZE_LOG2;
+
+    Node *allocate(Node *parent, Point left_extent);
+    void free(Node *node);
+    void clear();
+
+    Node *get(uint32_t index) const {
+      return &chunks[index >> CHUNK_SIZE_LOG2][index & (CHUNK_SIZE - 1)];
+    }
+
+  private:
+    std::vector<std::unique_ptr<Node[]>> chunks;
+    std::vector<uint32_t> free_indices;
+    uint32_t next_index = 0;
+  };
+
+  // Maps marker ids to the indices of their start and end nodes. Ids are
+  // normally handed out sequentially, so they index directly into a vector.
+  // Ids far beyond the number of markers are kept in a hash map instead.
+  class NodeTable {
+  public:
+    struct Entry {
+      uint32_t start_node;
+      uint32_t end_node;
+    };
+
+    const Entry *find(MarkerId id) const;
+    Entry *find(MarkerId id);
+    void insert(MarkerId id, Entry entry);
+    void erase(MarkerId id);
+    void clear();
+    size_t size() const { return count; }
+
+  private:
+    static const uint32_t NO_NODE = UINT32_MAX;
+
+    std::vector<Entry> dense_entries;
+    std::unordered_map<MarkerId, Entry> sparse_entries;
+    size_t count = 0;
+  };
+
   class Iterator {
   public:
     Iterator(MarkerIndex *marker_index);
@@ -79,11 +162,17 @@ private:
     Node* insert_marker_start(const MarkerId &id, const Point &start_position, const Point &end_position);
     Node* insert_marker_end(const MarkerId &id, const Point &start_position, const Point &end_position);
     Node* insert_splice_boundary(const Point &position, bool is_insertion_end);
-    void find_intersecting(const Point &start, const Point &end, flat_set<MarkerId> *result);
-    void find_contained_in(const Point &start, const Point &end, flat_set<MarkerId> *result);
-    void find_starting_in(const Point &start, const Point &end, flat_set<MarkerId> *result);
-    void find_ending_in(const Point &start, const Point &end, flat_set<MarkerId> *result);
+    void find_intersecting(const Point &start, const Point &end, MarkerIdSet *result);
+    void find_contained_in(const Point &start, const Point &end, MarkerIdSet *result);
+    void find_starting_in(const Point &start, const Point &end, MarkerIdSet *result);
+    void find_ending_in(const Point &start, const Point &end, MarkerIdSet *result);
     void find_boundaries_after(Point start, size_t max_count, BoundaryQueryResult *result);
+    void seek_to_boundary(Point start, std::vector<MarkerId> *containing_start);
+    void seek_past_boundary(Point position);
+    size_t append_packed_boundaries(size_t max_count, PackedBoundaries *result);
+    void dump_in_order(Snapshot *result);
+    void find_next_starting_after(Point position, size_t count, LayerMask mask, std::vector<MarkerId> *result);
+    void find_previous_ending_before(Point position, size_t count, LayerMask mask, std::vector<MarkerId> *result);
     std::unordered_map<MarkerId, Range> dump();
 
   private:
@@ -91,12 +180,14 @@ private:
     void descend_left();
     void descend_right();
     void move_to_successor();
+    void move_to_predecessor();
     void seek_to_first_node_greater_than_or_equal_to(const Point &position);
+    void seek_to_last_node_less_than(const Point &position);
     void mark_right(const MarkerId &id, const Point &start_position, const Point &end_position);
     void mark_left(const MarkerId &id, const Point &start_position, const Point &end_position);
     Node* insert_left_child(const Point &position);
     Node* insert_right_child(const Point &position);
-    void check_intersection(const Point &start, const Point &end, flat_set<MarkerId> *results);
+    void check_intersection(const Point &start, const Point &end, MarkerIdSet *results);
     void cache_node_position() const;
 
     MarkerIndex *marker_index;
@@ -109,23 +200,95 @@ private:
   };
 
   Point get_node_position(const Node *node) const;
+  void cache_node_position(const Node *node, Point position) const;
+  void invalidate_node_positions_from(Point position);
+  void clear_node_position_cache();
+  SpliceResult apply_splice(Point start, Point old_extent, Point new_extent);
+  void build_tree(std::vector<std::pair<MarkerId, Range>> &markers);
+  bool is_in_layers(MarkerId id, LayerMask mask) const;
+  Node *start_node_for(MarkerId id) const;
+  Node *end_node_for(MarkerId id) const;
   void delete_node(Node *node);
   void delete_subtree(Node *node);
   void bubble_node_up(Node *node);
   void bubble_node_down(Node *node);
   void rotate_node_left(Node *pivot);
   void rotate_node_right(Node *pivot);
-  void get_starting_and_ending_markers_within_subtree(const Node *node, flat_set<MarkerId> *starting, flat_set<MarkerId> *ending);
-  void populate_splice_invalidation_sets(SpliceResult *invalidated, const Node *start_node, const Node *end_node, const flat_set<MarkerId> &starting_inside_splice, const flat_set<MarkerId> &ending_inside_splice);
+  void get_starting_and_ending_markers_within_subtree(const Node *node, MarkerIdSet *starting, MarkerIdSet *ending);
+  void populate_splice_invalidation_sets(SpliceResult *invalidated, const Node *start_node, const Node *end_node, const MarkerIdSet &starting_inside_splice, const MarkerIdSet &ending_inside_splice);
 
   std::default_random_engine random_engine;
   std::uniform_int_distribution<int> random_distribution;
   Node *root;
-  std::unordered_map<MarkerId, Node*> start_nodes_by_id;
-  std::unordered_map<MarkerId, Node*> end_nodes_by_id;
+  NodePool node_pool;
+  NodeTable node_table;
   Iterator iterator;
-  flat_set<MarkerId> exclusive_marker_ids;
-  mutable std::unordered_map<const Node*, Point> node_position_cache;
+  MarkerIdSet exclusive_marker_ids;
+  std::vector<MarkerIdSet> layer_marker_ids;
+  unsigned version;
+  unsigned node_position_cache_generation;
+  unsigned node_position_cache_base_generation;
+  std::vector<std::pair<unsigned, Point>> node_position_cache_watermarks;
+};
+
+// Walks the boundaries of a MarkerIndex in order, a batch at a time, without
+// searching from the root for each batch. If the index is modified between
+// batches, the cursor searches again for the first boundary after the last
+// one it returned.
+class MarkerIndex::BoundaryCursor {
+public:
+  BoundaryCursor(MarkerIndex *marker_index);
+  std::vector<MarkerId> seek(Point start);
+  size_t next(size_t max_count, PackedBoundaries *result);
+
+private:
+  MarkerIndex *marker_index;
+  Iterator iterator;
+  unsigned version;
+  Point resume_position;
+  bool resume_past_position;
+};
+
+// An immutable copy of the marker ranges in a MarkerIndex. Queries on a
+// snapshot don't modify it, so a snapshot can be read from other threads while
+// the index it was taken from keeps changing.
+class MarkerIndex::Snapshot {
+public:
+  size_t size() const;
+  bool has(MarkerId id) const;
+  Point get_start(MarkerId id) const;
+  Point get_end(MarkerId id) const;
+  Range get_range(MarkerId id) const;
+
+  MarkerIdSet find_intersecting(Point start, Point end) const;
+  MarkerIdSet find_containing(Point start, Point end) const;
+  MarkerIdSet find_contained_in(Point start, Point end) const;
+  MarkerIdSet find_starting_in(Point start, Point end) const;
+  MarkerIdSet find_ending_in(Point start, Point end) const;
+
+  std::unordered_map<MarkerId, Range> dump() const;
+
+private:
+  friend class MarkerIndex;
+
+  struct Entry {
+    Range range;
+    MarkerId id;
+  };
+
+  void build_index();
+  Point build_max_ends(size_t begin, size_t end);
+  const Entry *find_entry(MarkerId id) const;
+  void collect_intersecting(size_t begin, size_t end, Point start, Point end_position, std::vector<uint32_t> *result) const;
+  template <typename Predicate>
+  MarkerIdSet find_intersecting_where(Point start, Point end, Predicate predicate) const;
+
+  // Entries are sorted by start position. They also form an implicit
+  // balanced search tree, whose root is the middle entry, and `max_ends`
+  // holds the greatest end position within the subtree rooted at each entry.
+  std::vector<Entry> entries;
+  std::vector<Point> max_ends;
+  std::vector<std::pair<MarkerId, uint32_t>> entry_indices_by_id;
 };
 
 #endif // MARKER_INDEX_H_
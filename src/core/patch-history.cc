@@ -0,0 +1,92 @@
+#include "patch-history.h"
+
+using std::move;
+using std::vector;
+
+PatchHistory::PatchHistory() : levels{1} {}
+
+bool PatchHistory::push(Patch &&patch) {
+  levels[0].push_back(move(patch));
+
+  size_t level = 0;
+  size_t index = levels[0].size() - 1;
+  while (index % 2 == 1) {
+    if (!compose_level(level + 1, index / 2)) {
+      truncate(size() - 1);
+      return false;
+    }
+    level++;
+    index /= 2;
+  }
+
+  return true;
+}
+
+bool PatchHistory::compose_level(size_t level, size_t index) {
+  if (levels.size() <= level) levels.emplace_back();
+
+  const vector<Patch> &children = levels[level - 1];
+  Patch combination;
+  if (!combination.combine(children[2 * index]) ||
+      !combination.combine(children[2 * index + 1], false)) {
+    return false;
+  }
+
+  levels[level].push_back(move(combination));
+  return true;
+}
+
+void PatchHistory::truncate(uint32_t checkpoint) {
+  for (size_t level = 0; level < levels.size(); level++) {
+    size_t count = checkpoint >> level;
+    if (levels[level].size() > count) {
+      levels[level].erase(levels[level].begin() + count, levels[level].end());
+    }
+  }
+  while (levels.size() > 1 && levels.back().empty()) levels.pop_back();
+}
+
+void PatchHistory::clear() {
+  levels.clear();
+  levels.emplace_back();
+}
+
+uint32_t PatchHistory::size() const {
+  return levels[0].size();
+}
+
+size_t PatchHistory::cached_patch_count() const {
+  size_t result = 0;
+  for (size_t level = 1; level < levels.size(); level++) {
+    result += levels[level].size();
+  }
+  return result;
+}
+
+optional<Patch> PatchHistory::compose(uint32_t start_checkpoint, uint32_t end_checkpoint) const {
+  bool reverse = start_checkpoint > end_checkpoint;
+  if (reverse) std::swap(start_checkpoint, end_checkpoint);
+  if (end_checkpoint > size()) return optional<Patch>{};
+
+  // Greedily cover the span with the largest aligned runs that fit inside it.
+  Patch result;
+  bool left_to_right = true;
+  uint32_t checkpoint = start_checkpoint;
+  while (checkpoint < end_checkpoint) {
+    size_t level = 0;
+    while (level + 1 < levels.size() &&
+           (checkpoint & ((2u << level) - 1)) == 0 &&
+           checkpoint + (2u << level) <= end_checkpoint) {
+      level++;
+    }
+
+    if (!result.combine(levels[level][checkpoint >> level], left_to_right)) {
+      return optional<Patch>{};
+    }
+    left_to_right = !left_to_right;
+    checkpoint += 1u << level;
+  }
+
+  if (reverse) return result.invert();
+  return optional<Patch>{move(result)};
+}
@@ -0,0 +1,35 @@
+#ifndef SUPERSTRING_PATCH_HISTORY_H
+#define SUPERSTRING_PATCH_HISTORY_H
+
+#include "optional.h"
+#include "patch.h"
+#include <vector>
+
+// Records the patch produced by each transaction on a buffer. Checkpoint `n`
+// refers to the state of the buffer after the first `n` transactions.
+//
+// To avoid recomposing every transaction when asked for the changes between
+// two distant checkpoints, the composition of each aligned run of 2^k
+// transactions is cached. Any span of checkpoints can then be covered by
+// O(log n) cached patches.
+class PatchHistory {
+  std::vector<std::vector<Patch>> levels;
+
+  bool compose_level(size_t level, size_t index);
+
+public:
+  PatchHistory();
+
+  bool push(Patch &&);
+  void truncate(uint32_t checkpoint);
+  void clear();
+  uint32_t size() const;
+  size_t cached_patch_count() const;
+
+  // Returns a patch transforming the buffer's text at `start_checkpoint`
+  // into its text at `end_checkpoint`. If `start_checkpoint` comes after
+  // `end_checkpoint`, the result reverts the intervening transactions.
+  optional<Patch> compose(uint32_t start_checkpoint, uint32_t end_checkpoint) const;
+};
+
+#endif // SUPERSTRING_PATCH_HISTORY_H
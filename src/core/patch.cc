@@ -3,13 +3,13 @@
 #include "text.h"
 #include "text-slice.h"
 #include <assert.h>
+#include <algorithm>
 #include <cmath>
 #include <memory>
 #include <stdio.h>
 #include <sstream>
 #include <vector>
 
-using std::function;
 using std::move;
 using std::vector;
 using std::unique_ptr;
@@ -36,6 +36,13 @@ struct Patch::Node {
   uint32_t old_subtree_text_size;
   uint32_t new_subtree_text_size;
 
+  // The offset in the old text of `old_start_for_offset`, recorded by the
+  // last offset lookup that visited this node. It can be reused for as long
+  // as the change still starts at that position.
+  Point old_start_for_offset;
+  uint32_t old_start_offset;
+  bool has_old_start_offset;
+
   Node(
     Node *left,
     Node *right,
@@ -55,7 +62,8 @@ struct Patch::Node {
     new_distance_from_left_ancestor{new_distance_from_left_ancestor},
     old_text{std::move(old_text)},
     new_text{std::move(new_text)},
-    old_text_size_{old_text_size} {
+    old_text_size_{old_text_size},
+    has_old_start_offset{false} {
     compute_subtree_text_sizes();
   }
 
@@ -65,7 +73,8 @@ struct Patch::Node {
     old_extent{input},
     new_extent{input},
     old_distance_from_left_ancestor{input},
-    new_distance_from_left_ancestor{input} {
+    new_distance_from_left_ancestor{input},
+    has_old_start_offset{false} {
 
     if (input.read<uint32_t>()) {
       old_text = unique_ptr<Text>{new Text{input}};
@@ -103,6 +112,15 @@ struct Patch::Node {
     return old_text ? old_text->size() : old_text_size_;
   }
 
+  uint32_t old_start_offset_in(Point old_start, BaseText &base_text) {
+    if (!has_old_start_offset || old_start_for_offset != old_start) {
+      old_start_for_offset = old_start;
+      old_start_offset = base_text.offset_for_position(old_start);
+      has_old_start_offset = true;
+    }
+    return old_start_offset;
+  }
+
   uint32_t left_subtree_old_text_size() const {
     return left ? left->old_subtree_text_size : 0;
   }
@@ -390,7 +408,7 @@ Patch::~Patch() {
   if (root) delete_node(&root);
 }
 
-void Patch::serialize(Serializer &output) {
+void Patch::serialize(Serializer &output) const {
   output.append(SERIALIZATION_VERSION);
   output.append(change_count);
 
@@ -398,7 +416,8 @@ void Patch::serialize(Serializer &output) {
   root->serialize(output);
 
   Node *node = root;
-  node_stack.clear();
+  vector<Node *> node_stack;
+  node_stack.reserve(change_count);
   int previous_node_child_index = -1;
 
   while (node) {
@@ -994,10 +1013,8 @@ optional<Change> Patch::get_change_ending_after_new_position(Point target) const
   return get_change_ending_after_position<NewCoordinates>(target);
 }
 
-Point Patch::new_position_for_new_offset(uint32_t target_offset,
-                                         function<uint32_t(Point)> old_offset_for_old_position,
-                                         function<Point(uint32_t)> old_position_for_old_offset) const {
-  const Node *node = root;
+Point Patch::new_position_for_new_offset(uint32_t target_offset, BaseText &old_text) {
+  Node *node = root;
   Patch::PositionStackEntry left_ancestor_info;
   Point preceding_new_position, preceding_old_position;
   uint32_t preceding_old_offset = 0, preceding_new_offset = 0;
@@ -1005,7 +1022,7 @@ Point Patch::new_position_for_new_offset(uint32_t target_offset,
   while (node) {
     Point node_old_start = left_ancestor_info.old_end.traverse(node->old_distance_from_left_ancestor);
     Point node_new_start = left_ancestor_info.new_end.traverse(node->new_distance_from_left_ancestor);
-    uint32_t node_old_start_offset = old_offset_for_old_position(node_old_start);
+    uint32_t node_old_start_offset = node->old_start_offset_in(node_old_start, old_text);
     uint32_t node_new_start_offset = node_old_start_offset -
       left_ancestor_info.total_old_text_size +
       left_ancestor_info.total_new_text_size -
@@ -1041,12 +1058,20 @@ Point Patch::new_position_for_new_offset(uint32_t target_offset,
   }
 
   return preceding_new_position.traverse(
-    old_position_for_old_offset(
+    old_text.position_for_offset(
       preceding_old_offset + (target_offset - preceding_new_offset)
     ).traversal(preceding_old_position)
   );
 }
 
+vector<Point> Patch::translate_old_to_new(const vector<Point> &old_positions) const {
+  return translate_positions<OldCoordinates, NewCoordinates>(old_positions);
+}
+
+vector<Point> Patch::translate_new_to_old(const vector<Point> &new_positions) const {
+  return translate_positions<NewCoordinates, OldCoordinates>(new_positions);
+}
+
 // Splaying reads
 
 vector<Change> Patch::grab_changes_in_old_range(Point start, Point end) {
@@ -1590,6 +1615,90 @@ optional<Patch::Change> Patch::get_change_starting_before_position(Point target)
   }
 }
 
+// Positions are answered in ascending order with a single in-order sweep of
+// the changes, so the tree is never splayed. Unsorted input is visited
+// through a sorted permutation and written back in its original order.
+//
+// A position preceding every change is unaffected. A position at or after
+// the end of a change is shifted by the same amount as that change's end. A
+// position at the start of a change maps to the start of the change in the
+// target space, and one inside a change is clipped to its end.
+template <typename SourceSpace, typename TargetSpace>
+vector<Point> Patch::translate_positions(const vector<Point> &positions) const {
+  vector<Point> result(positions.size());
+  if (positions.empty()) return result;
+
+  vector<uint32_t> order;
+  if (!std::is_sorted(positions.begin(), positions.end())) {
+    order.resize(positions.size());
+    for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&positions](uint32_t a, uint32_t b) {
+      return positions[a] < positions[b];
+    });
+  }
+
+  // Each pending node is paired with the end of its left ancestor, which is
+  // the same for a node and every node along its chain of left children.
+  vector<std::pair<const Node *, PositionStackEntry>> node_stack;
+  auto push_left_chain = [&node_stack](const Node *node, PositionStackEntry left_ancestor_info) {
+    for (; node; node = node->left) node_stack.push_back({node, left_ancestor_info});
+  };
+  push_left_chain(root, PositionStackEntry{});
+
+  Point next_source_start, next_source_end, next_target_start, next_target_end;
+  bool has_next_change = false;
+
+  auto advance = [&]() {
+    has_next_change = !node_stack.empty();
+    if (!has_next_change) return;
+
+    const Node *node = node_stack.back().first;
+    PositionStackEntry left_ancestor_info = node_stack.back().second;
+    node_stack.pop_back();
+
+    Point old_start = left_ancestor_info.old_end.traverse(node->old_distance_from_left_ancestor);
+    Point new_start = left_ancestor_info.new_end.traverse(node->new_distance_from_left_ancestor);
+    Point old_end = old_start.traverse(node->old_extent);
+    Point new_end = new_start.traverse(node->new_extent);
+    next_source_start = SourceSpace::choose(old_start, new_start);
+    next_source_end = SourceSpace::choose(old_end, new_end);
+    next_target_start = TargetSpace::choose(old_start, new_start);
+    next_target_end = TargetSpace::choose(old_end, new_end);
+
+    push_left_chain(node->right, PositionStackEntry{old_end, new_end, 0, 0});
+  };
+
+  advance();
+  Point current_source_start, current_source_end, current_target_start, current_target_end;
+  bool has_current_change = false;
+
+  for (size_t i = 0; i < positions.size(); i++) {
+    size_t index = order.empty() ? i : order[i];
+    Point position = positions[index];
+
+    while (has_next_change && next_source_start <= position) {
+      current_source_start = next_source_start;
+      current_source_end = next_source_end;
+      current_target_start = next_target_start;
+      current_target_end = next_target_end;
+      has_current_change = true;
+      advance();
+    }
+
+    if (!has_current_change) {
+      result[index] = position;
+    } else if (position >= current_source_end) {
+      result[index] = current_target_end.traverse(position.traversal(current_source_end));
+    } else if (position == current_source_start) {
+      result[index] = current_target_start;
+    } else {
+      result[index] = current_target_end;
+    }
+  }
+
+  return result;
+}
+
 template <typename CoordinateSpace>
 optional<Patch::Change> Patch::get_change_ending_after_position(Point target) const {
   Node *found_node = nullptr;
@@ -34,13 +34,25 @@ public:
     uint32_t old_text_size;
   };
 
+  // The text that a patch applies to. Patches only record the sizes of the
+  // changed regions, so mapping offsets through a patch requires looking up
+  // the offsets of unchanged positions in the old text.
+  class BaseText {
+   public:
+    virtual uint32_t offset_for_position(Point) = 0;
+    virtual Point position_for_offset(uint32_t) = 0;
+
+   protected:
+    ~BaseText() = default;
+  };
+
   // Construction and destruction
   Patch(bool merges_adjacent_changes = true);
   Patch(Patch &&);
   Patch(Deserializer &input);
   Patch &operator=(Patch &&);
   ~Patch();
-  void serialize(Serializer &serializer);
+  void serialize(Serializer &serializer) const;
 
   Patch copy();
   Patch invert();
@@ -65,9 +77,8 @@ public:
   optional<Change> get_change_starting_before_new_position(Point position) const;
   optional<Change> get_change_ending_after_new_position(Point position) const;
   optional<Change> get_bounds() const;
-  Point new_position_for_new_offset(uint32_t new_offset,
-                                    std::function<uint32_t(Point)> old_offset_for_old_position,
-                                    std::function<Point(uint32_t)> old_position_for_old_offset) const;
+  std::vector<Point> translate_old_to_new(const std::vector<Point> &old_positions) const;
+  std::vector<Point> translate_new_to_old(const std::vector<Point> &new_positions) const;
 
   // Splaying reads
   std::vector<Change> grab_changes_in_old_range(Point start, Point end);
@@ -76,6 +87,10 @@ public:
   optional<Change> grab_change_starting_before_new_position(Point position);
   optional<Change> grab_change_ending_after_new_position(Point position, bool exclusive = false);
 
+  // Offset lookups. Each change remembers the offset of its old start in
+  // `old_text`, so a patch must always be given the same old text.
+  Point new_position_for_new_offset(uint32_t new_offset, BaseText &old_text);
+
   // Debugging
   std::string get_dot_graph() const;
   std::string get_json() const;
@@ -92,6 +107,9 @@ private:
   template <typename CoordinateSpace>
   optional<Change> get_change_ending_after_position(Point target) const;
 
+  template <typename SourceSpace, typename TargetSpace>
+  std::vector<Point> translate_positions(const std::vector<Point> &) const;
+
   template <typename CoordinateSpace>
   std::vector<Change> grab_changes_in_range(Point, Point, bool inclusive = false);
 
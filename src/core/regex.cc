@@ -1,13 +1,60 @@
 #include "regex.h"
 #include <stdlib.h>
+#include <algorithm>
+#include <cctype>
 #include "pcre2.h"
 
 using std::u16string;
+using std::vector;
 using MatchResult = Regex::MatchResult;
 
 const char16_t EMPTY_PATTERN[] = u".{0}";
+const size_t LITERAL_SEARCH_BLOCK_SIZE = 32;
+const size_t MULTI_PATTERN_SEARCH_WINDOW_SIZE = 4096;
 
-Regex::Regex() : code{nullptr} {}
+Regex::Regex() : code{nullptr}, literal_ignores_case{false}, has_marks{false} {}
+
+// Returns the text matched by a pattern without any special characters. Like
+// PCRE, this treats a backslash before any ASCII punctuation as an escape.
+static optional<u16string> get_literal_text(const char16_t *pattern, uint32_t length) {
+  u16string result;
+  for (uint32_t i = 0; i < length; i++) {
+    char16_t c = pattern[i];
+    switch (c) {
+      case '\\':
+        if (i + 1 == length) return optional<u16string>{};
+        c = pattern[++i];
+        if (c >= 128 || isalnum(c)) return optional<u16string>{};
+        break;
+      case '^': case '$': case '.': case '|': case '?': case '*': case '+':
+      case '(': case ')': case '[': case ']': case '{': case '}':
+        return optional<u16string>{};
+    }
+    result += c;
+  }
+  return result;
+}
+
+static bool is_ascii(const u16string &text) {
+  for (char16_t c : text) {
+    if (c >= 128) return false;
+  }
+  return true;
+}
+
+static inline char16_t fold_ascii(char16_t c) {
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+// Escapes the ASCII punctuation in `text`, so that PCRE matches it literally.
+static u16string escape_literal_text(const u16string &text) {
+  u16string result;
+  for (char16_t c : text) {
+    if (c < 128 && !isalnum(c)) result += '\\';
+    result += c;
+  }
+  return result;
+}
 
 static u16string preprocess_pattern(const char16_t *pattern, uint32_t length) {
   u16string result;
@@ -47,22 +94,12 @@ static u16string preprocess_pattern(const char16_t *pattern, uint32_t length) {
 }
 
 
-Regex::Regex(const char16_t *pattern, uint32_t pattern_length, u16string *error_message, bool ignore_case, bool unicode) {
-  if (pattern_length == 0) {
-    pattern = EMPTY_PATTERN;
-    pattern_length = 4;
-  }
-
-  u16string final_pattern = preprocess_pattern(pattern, pattern_length);
-
+static pcre2_code *compile_pattern(const u16string &pattern, uint32_t options, u16string *error_message) {
   int error_number = 0;
   size_t error_offset = 0;
-  uint32_t options = PCRE2_MULTILINE;
-  if (ignore_case) options |= PCRE2_CASELESS;
-  if (unicode) options |= PCRE2_UTF;
-  code = pcre2_compile(
-    reinterpret_cast<const uint16_t *>(final_pattern.data()),
-    final_pattern.size(),
+  pcre2_code *code = pcre2_compile(
+    reinterpret_cast<const uint16_t *>(pattern.data()),
+    pattern.size(),
     options,
     &error_number,
     &error_offset,
@@ -73,20 +110,283 @@ Regex::Regex(const char16_t *pattern, uint32_t pattern_length, u16string *error_
     uint16_t message_buffer[256];
     size_t length = pcre2_get_error_message(error_number, message_buffer, 256);
     error_message->assign(message_buffer, message_buffer + length);
-    return;
+    return nullptr;
   }
 
   pcre2_jit_compile(
     code,
     PCRE2_JIT_COMPLETE|PCRE2_JIT_PARTIAL_HARD|PCRE2_JIT_PARTIAL_SOFT
   );
+  return code;
+}
+
+// An Aho-Corasick automaton that finds the leftmost match of any of a set of
+// literals. Characters are first mapped to the classes of the characters that
+// occur in the literals, with the two cases of each ASCII letter sharing a
+// class, so that the transitions out of every state fit in a dense table.
+// Matches of the literals that don't ignore case are then checked against the
+// original text.
+//
+// Once built, each transition holds the offset of the target state's row in
+// the table rather than its index, with the top bit set if any literals end
+// in that state, so that following a transition takes as few steps as
+// possible.
+struct Regex::LiteralSet {
+  static const uint32_t HAS_OUTPUTS = 1u << 31;
+
+  struct Literal {
+    u16string text;
+    uint32_t pattern_index;
+    bool ignore_case;
+  };
+
+  vector<Literal> literals;
+  vector<uint16_t> character_classes;
+  uint32_t class_count;
+  vector<uint32_t> transitions;
+  vector<uint32_t> partial_match_lengths;
+  vector<uint32_t> output_starts;
+  vector<uint32_t> outputs;
+  size_t max_length;
+
+  explicit LiteralSet(vector<Literal> &&literals)
+    : literals{std::move(literals)}, character_classes(UINT16_MAX + 1, 0), class_count{1}, max_length{0} {
+    for (const Literal &literal : this->literals) {
+      max_length = std::max(max_length, literal.text.size());
+      for (char16_t c : literal.text) {
+        char16_t folded = fold_ascii(c);
+        if (character_classes[folded] != 0) continue;
+        character_classes[folded] = class_count;
+        if (folded >= 'a' && folded <= 'z') character_classes[folded - ('a' - 'A')] = class_count;
+        class_count++;
+      }
+    }
+
+    // Build a trie of the literals, with each state's own outputs.
+    const uint32_t NO_STATE = UINT32_MAX;
+    transitions.assign(class_count, NO_STATE);
+    vector<uint32_t> depths{0};
+    vector<vector<uint32_t>> outputs_by_state(1);
+    for (uint32_t i = 0; i < this->literals.size(); i++) {
+      uint32_t state = 0;
+      for (char16_t c : this->literals[i].text) {
+        uint32_t &next_state = transitions[state * class_count + character_classes[c]];
+        if (next_state == NO_STATE) {
+          next_state = depths.size();
+          depths.push_back(depths[state] + 1);
+          outputs_by_state.emplace_back();
+          transitions.resize(transitions.size() + class_count, NO_STATE);
+        }
+        state = transitions[state * class_count + character_classes[c]];
+      }
+      outputs_by_state[state].push_back(i);
+    }
+
+    // Then visit the states breadth-first, pointing each missing transition
+    // at the state that the failure link would lead to, and adding the
+    // outputs of the failure link's state to each state's outputs. Along the
+    // way, find the longest suffix of each state's text that some literal
+    // continues past, which is where a partial match would start.
+    vector<uint32_t> failure_links(depths.size(), 0);
+    partial_match_lengths.assign(depths.size(), 0);
+    vector<uint32_t> queue{0};
+    for (size_t i = 0; i < queue.size(); i++) {
+      uint32_t state = queue[i];
+      if (state != 0) {
+        bool has_children = false;
+        for (uint32_t character_class = 0; character_class < class_count; character_class++) {
+          if (transitions[state * class_count + character_class] != NO_STATE) has_children = true;
+        }
+        partial_match_lengths[state] = has_children ? depths[state] : partial_match_lengths[failure_links[state]];
+      }
+      for (uint32_t character_class = 0; character_class < class_count; character_class++) {
+        uint32_t &next_state = transitions[state * class_count + character_class];
+        uint32_t failure_state = state == 0 ? 0 : transitions[failure_links[state] * class_count + character_class];
+        if (next_state == NO_STATE) {
+          next_state = failure_state;
+        } else {
+          failure_links[next_state] = failure_state;
+          auto &inherited_outputs = outputs_by_state[failure_state];
+          outputs_by_state[next_state].insert(
+            outputs_by_state[next_state].end(),
+            inherited_outputs.begin(),
+            inherited_outputs.end()
+          );
+          queue.push_back(next_state);
+        }
+      }
+    }
+
+    for (const auto &state_outputs : outputs_by_state) {
+      output_starts.push_back(outputs.size());
+      outputs.insert(outputs.end(), state_outputs.begin(), state_outputs.end());
+    }
+    output_starts.push_back(outputs.size());
+
+    for (uint32_t &next_state : transitions) {
+      uint32_t row = next_state * class_count;
+      next_state = outputs_by_state[next_state].empty() ? row : row | HAS_OUTPUTS;
+    }
+  }
+
+  // Like a PCRE match of an alternation of the literals, this returns the
+  // match that starts first, preferring the earliest pattern among those that
+  // start at the same position. A partial match is returned instead if one
+  // starts at or before that position.
+  MatchResult match(const char16_t *string, size_t length, unsigned options) const {
+    MatchResult result{MatchResult::None, 0, 0, 0};
+    size_t best_start = SIZE_MAX;
+    uint32_t row = 0;
+    size_t i = 0;
+    for (; i < length; i++) {
+      if (best_start != SIZE_MAX && i + 1 > best_start + max_length) break;
+
+      uint32_t transition = transitions[row + character_classes[string[i]]];
+      row = transition & ~HAS_OUTPUTS;
+      if (!(transition & HAS_OUTPUTS)) continue;
+
+      uint32_t state = row / class_count;
+      for (uint32_t j = output_starts[state], end = output_starts[state + 1]; j < end; j++) {
+        const Literal &literal = literals[outputs[j]];
+        size_t start = i + 1 - literal.text.size();
+        if (start > best_start || (start == best_start && literal.pattern_index > result.pattern_index)) continue;
+        if (!literal.ignore_case && !std::equal(literal.text.begin(), literal.text.end(), string + start)) continue;
+        best_start = start;
+        result = MatchResult{MatchResult::Full, start, i + 1, literal.pattern_index};
+      }
+    }
+
+    uint32_t partial_match_length = partial_match_lengths[row / class_count];
+    if (i == length && partial_match_length > 0 && !(options & MatchOptions::IsEndSearch)) {
+      size_t start = length - partial_match_length;
+      if (start <= best_start) return MatchResult{MatchResult::Partial, start, length, 0};
+    }
+
+    return result;
+  }
+};
+
+Regex::Regex(const char16_t *pattern, uint32_t pattern_length, u16string *error_message, bool ignore_case, bool unicode)
+  : code{nullptr}, literal_ignores_case{false}, has_marks{false} {
+  // In unicode mode PCRE also validates the subject and folds non-ASCII
+  // characters, so those patterns are always compiled.
+  if (pattern_length > 0 && !unicode) {
+    auto literal_text = get_literal_text(pattern, pattern_length);
+    if (literal_text && (!ignore_case || is_ascii(*literal_text))) {
+      set_literal_text(std::move(*literal_text), ignore_case);
+      return;
+    }
+  }
+
+  if (pattern_length == 0) {
+    pattern = EMPTY_PATTERN;
+    pattern_length = 4;
+  }
+
+  uint32_t options = PCRE2_MULTILINE;
+  if (ignore_case) options |= PCRE2_CASELESS;
+  if (unicode) options |= PCRE2_UTF;
+  code = compile_pattern(preprocess_pattern(pattern, pattern_length), options, error_message);
 }
 
 Regex::Regex(const u16string &pattern, u16string *error_message, bool ignore_case, bool unicode)
   : Regex(pattern.data(), pattern.size(), error_message, ignore_case, unicode) {}
 
-Regex::Regex(Regex &&other) : code{other.code} {
+// Literal patterns, and regexes without special characters, go into the
+// literal set on the same terms as a single pattern would be matched as a
+// literal. The rest are combined into a branch reset group, so that each
+// alternative's capture groups keep their numbers, and each alternative
+// ends with a mark that names the index of its pattern. Marks at the start
+// would keep PCRE from using the alternatives' first characters to skip
+// ahead.
+Regex::Regex(const vector<Pattern> &patterns, u16string *error_message, bool unicode)
+  : code{nullptr}, literal_ignores_case{false}, has_marks{false} {
+  vector<LiteralSet::Literal> literals;
+  u16string alternation;
+  for (uint32_t i = 0; i < patterns.size(); i++) {
+    const Pattern &pattern = patterns[i];
+    optional<u16string> literal_text;
+    if (pattern.is_literal) {
+      literal_text = pattern.source;
+    } else {
+      literal_text = get_literal_text(pattern.source.data(), pattern.source.size());
+    }
+    if (literal_text && !literal_text->empty() && !unicode &&
+        (!pattern.ignore_case || is_ascii(*literal_text))) {
+      literals.push_back(LiteralSet::Literal{std::move(*literal_text), i, pattern.ignore_case});
+      continue;
+    }
+
+    std::string index = std::to_string(i);
+    alternation += alternation.empty() ? u"(?|" : u"|";
+    alternation += pattern.ignore_case ? u"(?i:" : u"(?:";
+    alternation += pattern.is_literal ? escape_literal_text(pattern.source) : pattern.source;
+    alternation += u")(*MARK:" + u16string(index.begin(), index.end()) + u")";
+  }
+
+  if (!alternation.empty()) {
+    alternation += u")";
+    uint32_t options = PCRE2_MULTILINE;
+    if (unicode) options |= PCRE2_UTF;
+    if (!literals.empty()) options |= PCRE2_USE_OFFSET_LIMIT;
+    code = compile_pattern(preprocess_pattern(alternation.data(), alternation.size()), options, error_message);
+    if (!code) {
+      // Report the error of the pattern that caused it, if there is one.
+      for (const Pattern &pattern : patterns) {
+        if (pattern.is_literal) continue;
+        u16string pattern_error_message;
+        Regex(pattern.source, &pattern_error_message, pattern.ignore_case, unicode);
+        if (!pattern_error_message.empty()) {
+          *error_message = pattern_error_message;
+          break;
+        }
+      }
+      return;
+    }
+    has_marks = true;
+  }
+
+  if (!literals.empty()) literal_set.reset(new LiteralSet(std::move(literals)));
+}
+
+Regex::Regex(Regex &&other)
+  : code{other.code},
+    literal_text{std::move(other.literal_text)},
+    literal_ignores_case{other.literal_ignores_case},
+    literal_set{std::move(other.literal_set)},
+    has_marks{other.has_marks} {
   other.code = nullptr;
+  other.literal_text.clear();
+}
+
+Regex Regex::literal(const u16string &text, bool ignore_case) {
+  if (text.empty()) return Regex(text, nullptr, ignore_case);
+  Regex result;
+  result.set_literal_text(u16string(text), ignore_case);
+  return result;
+}
+
+void Regex::set_literal_text(u16string &&text, bool ignore_case) {
+  literal_text = std::move(text);
+  literal_ignores_case = ignore_case;
+  if (ignore_case) {
+    for (char16_t &c : literal_text) c = fold_ascii(c);
+  }
+}
+
+bool Regex::is_literal() const {
+  return !literal_text.empty();
+}
+
+bool Regex::literal_prefix_matches(const char16_t *string, size_t length) const {
+  if (literal_ignores_case) {
+    for (size_t i = 0; i < length; i++) {
+      if (fold_ascii(string[i]) != literal_text[i]) return false;
+    }
+    return true;
+  } else {
+    return std::equal(string, string + length, literal_text.data());
+  }
 }
 
 Regex::~Regex() {
@@ -94,29 +394,89 @@ Regex::~Regex() {
 }
 
 Regex::MatchData::MatchData(const Regex &regex)
-  : data{pcre2_match_data_create_from_pattern(regex.code, nullptr)} {}
+  : data{regex.code ? pcre2_match_data_create_from_pattern(regex.code, nullptr) : nullptr},
+    context{regex.code && regex.literal_set ? pcre2_match_context_create(nullptr) : nullptr} {}
 
 Regex::MatchData::~MatchData() {
-  pcre2_match_data_free(data);
+  if (data) pcre2_match_data_free(data);
+  if (context) pcre2_match_context_free(context);
 }
 
 MatchResult Regex::match(const char16_t *string, size_t length,
                          MatchData &match_data, unsigned options) const {
-  MatchResult result{MatchResult::None, 0, 0};
+  if (is_literal()) return match_literal(string, length, options);
+  if (!literal_set) return match_pcre(string, length, match_data, options);
+  if (!code) return literal_set->match(string, length, options);
+
+  // Both searches only look for matches that start within a window, which
+  // doubles in size until one of them finds something. Otherwise, each match
+  // of one kind would make the search for the other kind scan to the end of
+  // the string again.
+  MatchResult literal_result, pcre_result;
+  size_t window_start = 0;
+  for (size_t window_size = MULTI_PATTERN_SEARCH_WINDOW_SIZE;; window_size *= 2) {
+    size_t last_start = std::min(length, window_start + window_size);
+    pcre2_set_offset_limit(match_data.context, last_start);
+    pcre_result = match_pcre(string, length, match_data, options, window_start);
+
+    size_t literal_search_end = std::min(length, last_start + literal_set->max_length);
+    literal_result = literal_set->match(
+      string + window_start,
+      literal_search_end - window_start,
+      literal_search_end == length ? options : options | MatchOptions::IsEndSearch
+    );
+    literal_result.start_offset += window_start;
+    literal_result.end_offset += window_start;
+    if (literal_result.start_offset > last_start) literal_result.type = MatchResult::None;
+
+    if (pcre_result.type != MatchResult::None || literal_result.type != MatchResult::None) break;
+    if (last_start == length) break;
+    window_start = last_start + 1;
+  }
+
+  // An empty match at the end of the string could turn out to be the start of
+  // a literal once more of the text is available. PCRE reports a partial match
+  // in that case for its own alternatives, so do the same for the literals.
+  if (pcre_result.type == MatchResult::Full && pcre_result.start_offset == length &&
+      literal_result.type == MatchResult::None && !(options & MatchOptions::IsEndSearch)) {
+    return MatchResult{MatchResult::Partial, length, length, 0};
+  }
+
+  if (pcre_result.type == MatchResult::Error || literal_result.type == MatchResult::None) return pcre_result;
+  if (pcre_result.type == MatchResult::None) return literal_result;
+
+  // Prefer whichever result starts first. At the same start, a partial result
+  // wins, so that the search is retried once more of the text is available,
+  // and otherwise the earlier pattern wins.
+  if (literal_result.start_offset != pcre_result.start_offset) {
+    return literal_result.start_offset < pcre_result.start_offset ? literal_result : pcre_result;
+  }
+  if (literal_result.type == MatchResult::Partial) return literal_result;
+  if (pcre_result.type == MatchResult::Partial) return pcre_result;
+  return literal_result.pattern_index < pcre_result.pattern_index ? literal_result : pcre_result;
+}
+
+MatchResult Regex::match_pcre(const char16_t *string, size_t length,
+                              MatchData &match_data, unsigned options, size_t start_offset) const {
+  MatchResult result{MatchResult::None, 0, 0, 0};
 
   unsigned int pcre_options = 0;
   if (!(options & MatchOptions::IsEndSearch)) pcre_options |= PCRE2_PARTIAL_HARD;
   if (!(options & MatchOptions::IsBeginningOfLine)) pcre_options |= PCRE2_NOTBOL;
-  if (!(options & MatchOptions::IsEndOfLine)) pcre_options |= PCRE2_NOTEOL;
+  // Before the end of the search, the text that follows decides whether the
+  // string ends a line, so a `$` at the end is left to be reported as partial.
+  if ((options & MatchOptions::IsEndSearch) && !(options & MatchOptions::IsEndOfLine)) {
+    pcre_options |= PCRE2_NOTEOL;
+  }
 
   int status = pcre2_match(
     code,
     reinterpret_cast<const uint16_t *>(string),
     length,
-    0,
+    start_offset,
     pcre_options,
     match_data.data,
-    nullptr
+    match_data.context
   );
 
   if (status < 0) {
@@ -137,7 +497,66 @@ MatchResult Regex::match(const char16_t *string, size_t length,
     result.type = MatchResult::Full;
     result.start_offset = pcre2_get_ovector_pointer(match_data.data)[0];
     result.end_offset = pcre2_get_ovector_pointer(match_data.data)[1];
+    if (has_marks) {
+      for (PCRE2_SPTR mark = pcre2_get_mark(match_data.data); mark && *mark; mark++) {
+        result.pattern_index = result.pattern_index * 10 + (*mark - '0');
+      }
+    }
   }
 
   return result;
 }
+
+// Behaves like a PCRE match with PCRE2_PARTIAL_HARD: the leftmost complete
+// match wins, and otherwise a suffix of the string that could be the start of
+// a match is reported as partial, unless this is the end of the search.
+MatchResult Regex::match_literal(const char16_t *string, size_t length, unsigned options) const {
+  size_t literal_length = literal_text.size();
+
+  // Candidates are the positions where both the first and the last character
+  // of the literal match. They are looked for a block at a time, without any
+  // branches inside of a block, so that the compiler can vectorize the check.
+  // Setting the 0x20 bit maps an ASCII letter, and only an ASCII letter, to
+  // its lowercase form, which is what the literal holds when ignoring case.
+  if (length >= literal_length) {
+    size_t last_offset = literal_length - 1;
+    uint16_t first = literal_text.front(), last = literal_text.back();
+    uint16_t first_mask = 0, last_mask = 0;
+    if (literal_ignores_case) {
+      if (isalpha(first)) first_mask = 0x20;
+      if (isalpha(last)) last_mask = 0x20;
+    }
+
+    size_t start = 0, end = length - last_offset;
+    for (; start + LITERAL_SEARCH_BLOCK_SIZE <= end; start += LITERAL_SEARCH_BLOCK_SIZE) {
+      const char16_t *block = string + start;
+      uint16_t has_candidate = 0;
+      for (size_t i = 0; i < LITERAL_SEARCH_BLOCK_SIZE; i++) {
+        uint16_t first_in_block = block[i], last_in_block = block[i + last_offset];
+        has_candidate |= ((first_in_block | first_mask) == first) & ((last_in_block | last_mask) == last);
+      }
+      if (!has_candidate) continue;
+      for (size_t i = 0; i < LITERAL_SEARCH_BLOCK_SIZE; i++) {
+        if (literal_prefix_matches(block + i, literal_length)) {
+          return MatchResult{MatchResult::Full, start + i, start + i + literal_length};
+        }
+      }
+    }
+    for (; start < end; start++) {
+      if (literal_prefix_matches(string + start, literal_length)) {
+        return MatchResult{MatchResult::Full, start, start + literal_length};
+      }
+    }
+  }
+
+  if (!(options & MatchOptions::IsEndSearch)) {
+    size_t start = length >= literal_length ? length - literal_length + 1 : 0;
+    for (; start < length; start++) {
+      if (literal_prefix_matches(string + start, length - start)) {
+        return MatchResult{MatchResult::Partial, start, length};
+      }
+    }
+  }
+
+  return MatchResult{MatchResult::None, 0, 0};
+}
@@ -2,26 +2,60 @@
 #define REGEX_H_
 
 #include <cstdint>
+#include <memory>
 #include "optional.h"
 #include <string>
+#include <vector>
 
 struct pcre2_real_code_16;
 struct pcre2_real_match_data_16;
+struct pcre2_real_match_context_16;
 struct BuildRegexResult;
 
 class Regex {
+  struct LiteralSet;
+
   pcre2_real_code_16 *code;
+
+  // Patterns without any special characters are matched as plain text,
+  // without going through PCRE.
+  std::u16string literal_text;
+  bool literal_ignores_case;
+
+  // When searching for several patterns at once, the literal ones are matched
+  // together by an automaton, and the others are compiled into a single PCRE
+  // alternation that marks which of them matched.
+  std::unique_ptr<LiteralSet> literal_set;
+  bool has_marks;
+
   Regex(pcre2_real_code_16 *);
+  void set_literal_text(std::u16string &&, bool ignore_case);
+  bool is_literal() const;
+  bool literal_prefix_matches(const char16_t *, size_t length) const;
 
  public:
   Regex();
   Regex(const char16_t *, uint32_t, std::u16string *error_message, bool ignore_case = false, bool unicode = false);
   Regex(const std::u16string &, std::u16string *error_message, bool ignore_case = false, bool unicode = false);
+  struct Pattern {
+    std::u16string source;
+    bool is_literal;
+    bool ignore_case;
+  };
+
+  // Searches for all of the given patterns at once. Where several of them
+  // match at the same position, the one that comes first wins.
+  Regex(const std::vector<Pattern> &, std::u16string *error_message, bool unicode = false);
   Regex(Regex &&);
   ~Regex();
 
+  // Matches the given text exactly, or ignoring the case of ASCII letters,
+  // without treating any of its characters as special.
+  static Regex literal(const std::u16string &, bool ignore_case = false);
+
   class MatchData {
     pcre2_real_match_data_16 *data;
+    pcre2_real_match_context_16 *context;
     friend class Regex;
 
    public:
@@ -39,6 +73,7 @@ class Regex {
 
     size_t start_offset;
     size_t end_offset;
+    uint32_t pattern_index = 0;
   };
 
   enum MatchOptions {
@@ -49,6 +84,11 @@ class Regex {
   };
 
   MatchResult match(const char16_t *data, size_t length, MatchData &, unsigned options = 0) const;
+
+ private:
+  MatchResult match_literal(const char16_t *data, size_t length, unsigned options) const;
+  MatchResult match_pcre(const char16_t *data, size_t length, MatchData &, unsigned options,
+                         size_t start_offset = 0) const;
 };
 
 struct BuildRegexResult {
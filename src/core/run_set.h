@@ -0,0 +1,300 @@
+#ifndef SUPERSTRING_RUN_SET_H
+#define SUPERSTRING_RUN_SET_H
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+#include <algorithm>
+
+// A sorted set of unsigned integers, stored as runs of consecutive values.
+// Marker ids are allocated sequentially, so markers created together (search
+// results, lint diagnostics, blame decorations) tend to occupy a handful of
+// runs no matter how many of them there are. Unions, intersections and
+// differences with another set walk both run lists once.
+template <typename T> class run_set {
+  struct Run {
+    T first;
+    T last;
+  };
+
+  typedef std::vector<Run> contents_type;
+  contents_type runs;
+  size_t value_count = 0;
+
+  size_t find_run(T value) const {
+    return std::lower_bound(runs.begin(), runs.end(), value, [](const Run &run, T value) {
+      return run.last < value;
+    }) - runs.begin();
+  }
+
+  // Appends a run to a run list that is sorted by first value, merging it into
+  // the last run if the two overlap or touch.
+  static void append_run(contents_type &runs, Run run) {
+    if (!runs.empty() && (runs.back().last >= run.first || runs.back().last + 1 == run.first)) {
+      if (run.last > runs.back().last) runs.back().last = run.last;
+    } else {
+      runs.push_back(run);
+    }
+  }
+
+  void insert_run(Run run) {
+    size_t start_index = std::lower_bound(runs.begin(), runs.end(), run, [](const Run &a, const Run &b) {
+      return a.last < b.first && a.last + 1 < b.first;
+    }) - runs.begin();
+
+    size_t end_index = start_index;
+    while (end_index < runs.size() && (runs[end_index].first <= run.last || runs[end_index].first - 1 == run.last)) {
+      const Run &merged_run = runs[end_index];
+      if (merged_run.first < run.first) run.first = merged_run.first;
+      if (merged_run.last > run.last) run.last = merged_run.last;
+      value_count -= static_cast<size_t>(merged_run.last - merged_run.first) + 1;
+      end_index++;
+    }
+
+    value_count += static_cast<size_t>(run.last - run.first) + 1;
+    if (start_index == end_index) {
+      runs.insert(runs.begin() + start_index, run);
+    } else {
+      runs[start_index] = run;
+      runs.erase(runs.begin() + start_index + 1, runs.begin() + end_index);
+    }
+  }
+
+  void assign_runs(contents_type &&new_runs) {
+    runs = std::move(new_runs);
+    value_count = 0;
+    for (const Run &run : runs) value_count += static_cast<size_t>(run.last - run.first) + 1;
+  }
+
+public:
+  class const_iterator {
+    friend class run_set;
+    const contents_type *runs;
+    size_t run_index;
+    T value;
+
+    const_iterator(const contents_type *runs, size_t run_index) :
+      runs{runs},
+      run_index{run_index},
+      value{run_index < runs->size() ? (*runs)[run_index].first : T{}} {}
+
+    const_iterator(const contents_type *runs, size_t run_index, T value) :
+      runs{runs},
+      run_index{run_index},
+      value{value} {}
+
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const T *pointer;
+    typedef const T &reference;
+
+    const_iterator() : runs{nullptr}, run_index{0}, value{} {}
+
+    reference operator*() const {
+      return value;
+    }
+
+    pointer operator->() const {
+      return &value;
+    }
+
+    const_iterator &operator++() {
+      if (value == (*runs)[run_index].last) {
+        run_index++;
+        value = run_index < runs->size() ? (*runs)[run_index].first : T{};
+      } else {
+        value++;
+      }
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator result = *this;
+      ++*this;
+      return result;
+    }
+
+    bool operator==(const const_iterator &other) const {
+      return run_index == other.run_index && value == other.value;
+    }
+
+    bool operator!=(const const_iterator &other) const {
+      return !(*this == other);
+    }
+  };
+
+  typedef const_iterator iterator;
+
+  void insert(T value) {
+    size_t index = find_run(value);
+    if (index < runs.size() && runs[index].first <= value) return;
+
+    bool joins_previous = index > 0 && runs[index - 1].last + 1 == value;
+    bool joins_next = index < runs.size() && value + 1 == runs[index].first;
+    if (joins_previous && joins_next) {
+      runs[index - 1].last = runs[index].last;
+      runs.erase(runs.begin() + index);
+    } else if (joins_previous) {
+      runs[index - 1].last = value;
+    } else if (joins_next) {
+      runs[index].first = value;
+    } else {
+      runs.insert(runs.begin() + index, Run{value, value});
+    }
+    value_count++;
+  }
+
+  template <typename Iterator>
+  void insert(Iterator start, Iterator end) {
+    for (auto i = start; i != end; i++) {
+      insert(*i);
+    }
+  }
+
+  void insert(const run_set &other) {
+    if (other.runs.empty()) return;
+    if (runs.empty()) {
+      *this = other;
+      return;
+    }
+
+    // Merging copies every run, so fold a few runs into a much larger set
+    // one at a time instead.
+    if (other.runs.size() * 8 < runs.size()) {
+      for (const Run &run : other.runs) insert_run(run);
+      return;
+    }
+
+    contents_type result;
+    result.reserve(runs.size() + other.runs.size());
+    auto i = runs.begin(), j = other.runs.begin();
+    while (i != runs.end() || j != other.runs.end()) {
+      if (j == other.runs.end() || (i != runs.end() && i->first < j->first)) {
+        append_run(result, *i++);
+      } else {
+        append_run(result, *j++);
+      }
+    }
+    assign_runs(std::move(result));
+  }
+
+  iterator erase(const iterator &iter) {
+    size_t index = iter.run_index;
+    T value = iter.value;
+    Run &run = runs[index];
+    value_count--;
+
+    if (run.first == run.last) {
+      runs.erase(runs.begin() + index);
+      return iterator(&runs, index);
+    } else if (value == run.first) {
+      run.first++;
+      return iterator(&runs, index, run.first);
+    } else if (value == run.last) {
+      run.last--;
+      return iterator(&runs, index + 1);
+    } else {
+      Run tail{static_cast<T>(value + 1), run.last};
+      run.last = value - 1;
+      runs.insert(runs.begin() + index + 1, tail);
+      return iterator(&runs, index + 1, tail.first);
+    }
+  }
+
+  void erase(T value) {
+    size_t index = find_run(value);
+    if (index < runs.size() && runs[index].first <= value) {
+      erase(iterator(&runs, index, value));
+    }
+  }
+
+  void erase(const run_set &other) {
+    if (runs.empty() || other.runs.empty()) return;
+
+    contents_type result;
+    result.reserve(runs.size() + other.runs.size());
+    auto j = other.runs.begin();
+    for (Run run : runs) {
+      while (j != other.runs.end() && j->last < run.first) j++;
+      auto k = j;
+      bool is_empty = false;
+      while (k != other.runs.end() && k->first <= run.last) {
+        if (k->first > run.first) result.push_back(Run{run.first, static_cast<T>(k->first - 1)});
+        if (k->last >= run.last) {
+          is_empty = true;
+          break;
+        }
+        run.first = k->last + 1;
+        k++;
+      }
+      if (!is_empty) result.push_back(run);
+    }
+    assign_runs(std::move(result));
+  }
+
+  run_set intersection(const run_set &other) const {
+    run_set result;
+    auto i = runs.begin(), j = other.runs.begin();
+    while (i != runs.end() && j != other.runs.end()) {
+      T first = std::max(i->first, j->first);
+      T last = std::min(i->last, j->last);
+      if (first <= last) {
+        result.runs.push_back(Run{first, last});
+        result.value_count += static_cast<size_t>(last - first) + 1;
+      }
+      if (i->last < j->last) {
+        i++;
+      } else {
+        j++;
+      }
+    }
+    return result;
+  }
+
+  // Writes the values in ascending order to `output`, which must have room
+  // for `size()` of them.
+  void copy_to(T *output) const {
+    for (const Run &run : runs) {
+      for (T value = run.first;; value++) {
+        *output++ = value;
+        if (value == run.last) break;
+      }
+    }
+  }
+
+  iterator begin() const {
+    return iterator(&runs, 0);
+  }
+
+  iterator end() const {
+    return iterator(&runs, runs.size());
+  }
+
+  size_t count(T value) const {
+    size_t index = find_run(value);
+    return index < runs.size() && runs[index].first <= value ? 1 : 0;
+  }
+
+  size_t size() const {
+    return value_count;
+  }
+
+  bool empty() const {
+    return runs.empty();
+  }
+
+  size_t run_count() const {
+    return runs.size();
+  }
+
+  bool operator==(const run_set &other) const {
+    return runs.size() == other.runs.size() && std::equal(
+      runs.begin(), runs.end(), other.runs.begin(),
+      [](const Run &a, const Run &b) { return a.first == b.first && a.last == b.last; }
+    );
+  }
+};
+
+#endif // SUPERSTRING_RUN_SET_H
@@ -3,37 +3,133 @@
 
 #include <vector>
 #include <cstdint>
+#include <cstring>
+#include <functional>
+
+inline bool host_is_little_endian() {
+  const uint16_t value = 1;
+  uint8_t first_byte;
+  std::memcpy(&first_byte, &value, 1);
+  return first_byte == 1;
+}
 
 class Serializer {
+ public:
+  using WriteCallback = std::function<bool(const uint8_t *, size_t)>;
+
+ private:
   std::vector<uint8_t> &vector;
+  WriteCallback write_callback;
+  size_t chunk_size;
+  bool ok;
 
  public:
   inline Serializer(std::vector<uint8_t> &output) :
-    vector(output) {};
+    vector(output),
+    chunk_size(SIZE_MAX),
+    ok(true) {};
+
+  // Hands the contents of `buffer` to `write_callback` whenever it grows to
+  // `chunk_size` bytes, so the serialized output never has to be held in
+  // memory all at once. Call `flush` when done to write the remainder.
+  inline Serializer(std::vector<uint8_t> &buffer, WriteCallback write_callback, size_t chunk_size) :
+    vector(buffer),
+    write_callback(std::move(write_callback)),
+    chunk_size(chunk_size),
+    ok(true) {
+    vector.reserve(chunk_size);
+  };
 
   template <typename T>
   void append(T value) {
+    if (vector.size() + sizeof(T) > chunk_size) flush();
     for (auto i = 0u; i < sizeof(T); i++) {
       vector.push_back(value & 0xFF);
       value >>= 8;
     }
   }
+
+  template <typename T>
+  void append_array(const T *values, size_t count) {
+    if (!host_is_little_endian()) {
+      for (size_t i = 0; i < count; i++) append(values[i]);
+      return;
+    }
+
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(values);
+    size_t byte_count = count * sizeof(T);
+    while (byte_count > 0) {
+      size_t room = chunk_size > vector.size() ? chunk_size - vector.size() : 0;
+      size_t bytes_to_copy = byte_count < room ? byte_count : room;
+      vector.insert(vector.end(), bytes, bytes + bytes_to_copy);
+      bytes += bytes_to_copy;
+      byte_count -= bytes_to_copy;
+      if (vector.size() >= chunk_size) flush();
+    }
+  }
+
+  // Returns false if any write has failed.
+  bool flush() {
+    if (write_callback && !vector.empty()) {
+      if (ok) ok = write_callback(vector.data(), vector.size());
+      vector.clear();
+    }
+    return ok;
+  }
 };
 
+// Reads values out of a borrowed byte range. The bytes are not copied, so
+// they must outlive the deserializer. Alternatively, the input can be pulled
+// from `read_callback` one chunk at a time.
 class Deserializer {
+ public:
+  using ReadCallback = std::function<size_t(uint8_t *, size_t)>;
+
+ private:
   const uint8_t *read_ptr;
   const uint8_t *end_ptr;
+  ReadCallback read_callback;
+  std::vector<uint8_t> chunk;
+
+  void fill(size_t size) {
+    if (!read_callback || remaining() >= size) return;
+
+    size_t leftover_size = remaining();
+    std::memmove(chunk.data(), read_ptr, leftover_size);
+    size_t chunk_size = leftover_size;
+    while (chunk_size < chunk.size()) {
+      size_t bytes_read = read_callback(chunk.data() + chunk_size, chunk.size() - chunk_size);
+      if (bytes_read == 0) break;
+      chunk_size += bytes_read;
+    }
+
+    read_ptr = chunk.data();
+    end_ptr = chunk.data() + chunk_size;
+  }
 
  public:
+  inline Deserializer(const uint8_t *data, size_t size) :
+    read_ptr(data),
+    end_ptr(data + size) {};
+
   inline Deserializer(const std::vector<uint8_t> &input) :
-    read_ptr(input.data()),
-    end_ptr(input.data() + input.size()) {};
+    Deserializer(input.data(), input.size()) {};
+
+  inline Deserializer(ReadCallback read_callback, size_t chunk_size) :
+    read_callback(std::move(read_callback)),
+    chunk(chunk_size < sizeof(uint64_t) ? sizeof(uint64_t) : chunk_size) {
+    read_ptr = end_ptr = chunk.data();
+  };
+
+  size_t remaining() const {
+    return read_ptr < end_ptr ? end_ptr - read_ptr : 0;
+  }
 
   template <typename T>
   T peek() const {
     T value = 0;
     const uint8_t *temp_ptr = read_ptr;
-    if (static_cast<unsigned>(end_ptr - temp_ptr) >= sizeof(T)) {
+    if (remaining() >= sizeof(T)) {
       for (auto i = 0u; i < sizeof(T); i++) {
         value |= static_cast<T>(*(temp_ptr++)) << static_cast<T>(8 * i);
       }
@@ -43,10 +139,39 @@ class Deserializer {
 
   template <typename T>
   T read() {
+    fill(sizeof(T));
     T value = peek<T>();
-    read_ptr += sizeof(T);
+    read_ptr = remaining() >= sizeof(T) ? read_ptr + sizeof(T) : end_ptr;
     return value;
   }
+
+  // Reads `count` consecutive values into `output`. On little-endian hosts
+  // the serialized layout matches the in-memory layout, so this is a single
+  // copy per chunk. Values past the end of the input are zero-filled, like
+  // `read`.
+  template <typename T>
+  void read_array(T *output, size_t count) {
+    size_t read_count = 0;
+    while (read_count < count) {
+      fill(sizeof(T));
+      size_t available_count = remaining() / sizeof(T);
+      if (available_count == 0) break;
+      if (available_count > count - read_count) available_count = count - read_count;
+
+      if (host_is_little_endian()) {
+        std::memcpy(output + read_count, read_ptr, available_count * sizeof(T));
+        read_ptr += available_count * sizeof(T);
+      } else {
+        for (size_t i = 0; i < available_count; i++) output[read_count + i] = read<T>();
+      }
+      read_count += available_count;
+    }
+
+    if (read_count < count) {
+      std::memset(output + read_count, 0, (count - read_count) * sizeof(T));
+      read_ptr = end_ptr;
+    }
+  }
 };
 
 #endif // SERIALIZER_H_
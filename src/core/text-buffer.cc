@@ -1,6 +1,7 @@
 #include "text-slice.h"
 #include "text-buffer.h"
 #include "regex.h"
+#include "word-index.h"
 #include <algorithm>
 #include <cassert>
 #include <cwctype>
@@ -22,7 +23,7 @@ uint32_t TextBuffer::MAX_CHUNK_SIZE_TO_COPY = 1024;
 
 static Text EMPTY_TEXT;
 
-struct TextBuffer::Layer {
+struct TextBuffer::Layer final : Patch::BaseText {
   Layer *previous_layer;
   Patch patch;
   optional<Text> text;
@@ -206,19 +207,15 @@ struct TextBuffer::Layer {
     return false;
   }
 
-  Point position_for_offset(uint32_t goal_offset) const {
+  uint32_t offset_for_position(Point position) override {
+    return clip_position(position).offset;
+  }
+
+  Point position_for_offset(uint32_t goal_offset) override {
     if (text) {
       return text->position_for_offset(goal_offset);
     } else {
-      return patch.new_position_for_new_offset(
-        goal_offset,
-        [this](Point old_position) {
-          return previous_layer->clip_position(old_position).offset;
-        },
-        [this](uint32_t old_offset) {
-          return previous_layer->position_for_offset(old_offset);
-        }
-      );
+      return patch.new_position_for_new_offset(goal_offset, *previous_layer);
     }
   }
 
@@ -273,9 +270,23 @@ struct TextBuffer::Layer {
 
     uint32_t minimum_match_row = range.start.row;
     Range last_match{Point::max(), Point::max()};
+    uint32_t last_match_pattern_index = 0;
     bool last_match_is_pending = false;
     bool done = false;
+
+    // Matches that cross chunk boundaries are searched for in a copy of the
+    // text around the boundary. The copy is reused for the whole scan, and as
+    // the search advances through it, only the start of the part that is
+    // still to be searched moves, so that the rest isn't copied again.
     Text chunk_continuation;
+    Point chunk_continuation_start;
+    auto remaining_continuation = [&]() {
+      return TextSlice(chunk_continuation).suffix(chunk_continuation_start);
+    };
+    auto clear_continuation = [&]() {
+      chunk_continuation.clear();
+      chunk_continuation_start = Point();
+    };
     TextSlice slice_to_search;
     Point chunk_start_position = range.start;
     Point last_search_end_position = range.start;
@@ -294,26 +305,29 @@ struct TextBuffer::Layer {
           // endings are not valid.
           if (last_match_is_pending) {
             if (!remaining_chunk.empty() && remaining_chunk.front() == '\n') {
-              chunk_continuation.splice(Point(), Point(), Text{u"\r"});
+              Text continuation{u"\r"};
+              continuation.append(remaining_continuation());
+              chunk_continuation = move(continuation);
+              chunk_continuation_start = Point();
               slice_to_search_start_position.column--;
               last_match.end.column--;
             }
 
             last_match_is_pending = false;
-            if (callback(last_match)) {
+            if (callback(last_match, last_match_pattern_index)) {
               done = true;
               return true;
             }
           }
 
-          if (!chunk_continuation.empty()) {
+          if (!chunk_continuation.empty() && !remaining_continuation().empty()) {
             chunk_continuation.append(remaining_chunk.prefix(MAX_CHUNK_SIZE_TO_COPY));
-            slice_to_search = TextSlice(chunk_continuation);
+            slice_to_search = remaining_continuation();
           } else {
             slice_to_search = remaining_chunk;
           }
         } else {
-          slice_to_search = TextSlice(chunk_continuation);
+          slice_to_search = remaining_continuation();
         }
 
         Point slice_to_search_end_position =
@@ -337,25 +351,30 @@ struct TextBuffer::Layer {
 
         switch (match_result.type) {
           case MatchResult::Error:
-            chunk_continuation.clear();
+            clear_continuation();
             return true;
 
           case MatchResult::None:
             last_search_end_position = slice_to_search_start_position.traverse(slice_to_search.extent());
             slice_to_search_start_position = last_search_end_position;
             minimum_match_row = slice_to_search_start_position.row;
-            chunk_continuation.clear();
+            clear_continuation();
             break;
 
           case MatchResult::Partial:
             last_search_end_position = slice_to_search_start_position.traverse(slice_to_search.extent());
-            if (chunk_continuation.empty() || match_result.start_offset > 0) {
+            if (slice_to_search.text != &chunk_continuation || match_result.start_offset > 0) {
               Point partial_match_position = slice_to_search.position_for_offset(match_result.start_offset,
                 minimum_match_row - slice_to_search_start_position.row
               );
               slice_to_search_start_position = slice_to_search_start_position.traverse(partial_match_position);
               minimum_match_row = slice_to_search_start_position.row;
-              chunk_continuation.assign(slice_to_search.suffix(partial_match_position));
+              if (slice_to_search.text == &chunk_continuation) {
+                chunk_continuation_start = chunk_continuation_start.traverse(partial_match_position);
+              } else {
+                chunk_continuation.assign(slice_to_search.suffix(partial_match_position));
+                chunk_continuation_start = Point();
+              }
             }
             break;
 
@@ -372,6 +391,7 @@ struct TextBuffer::Layer {
               slice_to_search_start_position.traverse(match_start_position),
               slice_to_search_start_position.traverse(match_end_position)
             };
+            last_match_pattern_index = match_result.pattern_index;
 
             last_search_end_position = last_match.end;
             if (match_end_position == match_start_position) {
@@ -383,21 +403,27 @@ struct TextBuffer::Layer {
             }
             minimum_match_row = last_search_end_position.row;
 
+            // If the match ends with a CR at the end of a chunk, continue looking
+            // at the next chunk, in case that chunk starts with an LF.
+            bool match_ends_with_cr =
+              match_result.end_offset == slice_to_search.size() && slice_to_search.back() == '\r';
+
+            // After an empty match, the search resumes one character past the
+            // match, so the continuation has to skip that character too.
+            Point search_resume_position = last_search_end_position.traversal(slice_to_search_start_position);
             slice_to_search_start_position = last_search_end_position;
             if (slice_to_search_start_position >= chunk_start_position) {
-              chunk_continuation.clear();
+              clear_continuation();
             } else {
-              chunk_continuation.assign(slice_to_search.suffix(match_end_position));
+              chunk_continuation_start = chunk_continuation_start.traverse(search_resume_position);
             }
 
-            // If the match ends with a CR at the end of a chunk, continue looking
-            // at the next chunk, in case that chunk starts with an LF.
-            if (match_result.end_offset == slice_to_search.size() && slice_to_search.back() == '\r') {
+            if (match_ends_with_cr) {
               last_match_is_pending = true;
               continue;
             }
 
-            if (callback(last_match)) {
+            if (callback(last_match, last_match_pattern_index)) {
               done = true;
               return true;
             }
@@ -409,7 +435,7 @@ struct TextBuffer::Layer {
     }, splay);
 
     if (last_match_is_pending) {
-      callback(last_match);
+      callback(last_match, last_match_pattern_index);
     } else if (!done && last_match.end != range.end) {
       static char16_t EMPTY[] = {0};
       unsigned options = MatchOptions::IsEndSearch;
@@ -419,14 +445,51 @@ struct TextBuffer::Layer {
       }
       MatchResult match_result = regex.match(EMPTY, 0, match_data, options);
       if (match_result.type == MatchResult::Partial || match_result.type == MatchResult::Full) {
-        callback(Range{range.end, range.end});
+        callback(Range{range.end, range.end}, match_result.pattern_index);
       }
     }
   }
 
+  template <typename Callback, typename PartCallback>
+  void scan_in_range_prioritized(const Regex &regex, Range range, Range priority_range,
+                                 const Callback &callback, const PartCallback &part_callback) {
+    range.start = clip_position(range.start).position;
+    range.end = clip_position(range.end).position;
+    Point priority_start = clip_position(Point{priority_range.start.row, 0}).position;
+    Point priority_end = priority_range.end.row < UINT32_MAX
+      ? clip_position(Point{priority_range.end.row + 1, 0}).position
+      : range.end;
+    priority_start = std::min(std::max(priority_start, range.start), range.end);
+    priority_end = std::min(std::max(priority_end, priority_start), range.end);
+
+    bool done = false;
+    auto search_part = [&](Range part, bool includes_end) {
+      scan_in_range(regex, part, [&](Range match_range, uint32_t pattern_index) -> bool {
+        if (!includes_end && match_range.start >= part.end) return true;
+        done = callback(match_range, pattern_index);
+        return done;
+      });
+      part_callback();
+    };
+
+    // Only the last non-empty part in the buffer can match at the end of the
+    // range.
+    bool priority_part_is_empty = priority_start == priority_end;
+    bool part_below_is_empty = priority_end == range.end;
+    if (!priority_part_is_empty || range.start == range.end) {
+      search_part({priority_start, priority_end}, part_below_is_empty);
+    }
+    if (!done && !part_below_is_empty) {
+      search_part({priority_end, range.end}, true);
+    }
+    if (!done && range.start < priority_start) {
+      search_part({range.start, priority_start}, priority_part_is_empty && part_below_is_empty);
+    }
+  }
+
   optional<Range> find_in_range(const Regex &regex, Range range, bool splay = false) {
     optional<Range> result;
-    scan_in_range(regex, range, [&result](Range match_range) -> bool {
+    scan_in_range(regex, range, [&result](Range match_range, uint32_t) -> bool {
       result = match_range;
       return true;
     }, splay);
@@ -435,54 +498,52 @@ struct TextBuffer::Layer {
 
   vector<Range> find_all_in_range(const Regex &regex, Range range, bool splay = false) {
     vector<Range> result;
-    scan_in_range(regex, range, [&result](Range match_range) -> bool {
+    scan_in_range(regex, range, [&result](Range match_range, uint32_t) -> bool {
       result.push_back(match_range);
       return false;
     }, splay);
     return result;
   }
 
-  unsigned find_and_mark_all_in_range(MarkerIndex &index, MarkerIndex::MarkerId first_id,
-                                      bool exclusive, const Regex &regex, Range range, bool splay = false) {
-    unsigned id = first_id;
-    scan_in_range(regex, range, [&index, &id, exclusive](Range match_range) -> bool {
-      index.insert(id, match_range.start, match_range.end);
-      index.set_exclusive(id, exclusive);
-      id++;
+  vector<PatternMatch> find_all_multi_in_range(const Regex &regex, Range range, bool splay = false) {
+    vector<PatternMatch> result;
+    scan_in_range(regex, range, [&result](Range match_range, uint32_t pattern_index) -> bool {
+      result.push_back(PatternMatch{pattern_index, match_range});
       return false;
     }, splay);
-    return id - first_id;
+    return result;
   }
 
-  struct SubsequenceMatchVariant {
-    size_t query_index = 0;
-    std::vector<uint32_t> match_indices;
-    int16_t score = 0;
+  unsigned find_and_mark_all_in_range(MarkerIndex &index, MarkerIndex::MarkerId first_id,
+                                      bool exclusive, const Regex &regex, Range range, bool splay = false) {
+    vector<MarkerIndex::MarkerId> ids;
+    vector<Range> ranges;
+    scan_in_range(regex, range, [&ids, &ranges, first_id](Range match_range, uint32_t) -> bool {
+      ids.push_back(first_id + ids.size());
+      ranges.push_back(match_range);
+      return false;
+    }, splay);
 
-    bool operator<(const SubsequenceMatchVariant &other) const {
-      return query_index < other.query_index;
+    index.insert_many(ids, ranges);
+    if (exclusive) {
+      for (MarkerIndex::MarkerId id : ids) index.set_exclusive(id, true);
     }
-  };
+    return ids.size();
+  }
 
-  vector<SubsequenceMatch> find_words_with_subsequence_in_range(u16string query, const u16string &extra_word_characters, Range range) {
-    const size_t MAX_WORD_LENGTH = 80;
+  // Adds the start positions of the words between `start` and `end` that
+  // contain `query` as a subsequence.
+  void scan_words_with_subsequence(const u16string &query, const u16string &extra_word_characters, Point start, Point end,
+                                   std::unordered_map<u16string, vector<Point>> *substring_matches) {
+    const size_t MAX_WORD_LENGTH = WordIndex::MAX_WORD_LENGTH;
     size_t query_index = 0;
-    Point position;
+    Point position = start;
     Point current_word_start;
     u16string current_word;
-    u16string raw_query = query;
-
-    if (query.size() > MAX_WORD_LENGTH) return vector<SubsequenceMatch>{};
-
-    std::transform(query.begin(), query.end(), query.begin(), std::towlower);
-
-    // First, find the start position of all words matching the given
-    // subsequence.
-    std::unordered_map<u16string, vector<Point>> substring_matches;
 
     for_each_chunk_in_range(
-      clip_position(range.start).position,
-      clip_position(range.end).position,
+      start,
+      end,
       [&] (TextSlice chunk) -> bool {
         for (uint16_t c : chunk) {
           bool is_word_character =
@@ -498,7 +559,7 @@ struct TextBuffer::Layer {
           } else {
             if (!current_word.empty()) {
               if (query_index == query.size() && current_word.size() <= MAX_WORD_LENGTH) {
-                substring_matches[current_word].push_back(current_word_start);
+                (*substring_matches)[current_word].push_back(current_word_start);
               }
               query_index = 0;
               current_word.clear();
@@ -517,124 +578,95 @@ struct TextBuffer::Layer {
       });
 
     if (!current_word.empty() && query_index == query.size() && current_word.size() <= MAX_WORD_LENGTH) {
-      substring_matches[current_word].push_back(current_word_start);
+      (*substring_matches)[current_word].push_back(current_word_start);
     }
+  }
 
-    // Next, calculate a score for each word indicating the quality of the
-    // match against the query.
+  // Adds the start position of all words in the range that contain `query`
+  // as a subsequence. Rows that lie entirely within the range are looked up in
+  // the word index, if there is one, and partially covered rows are scanned.
+  void collect_words_with_subsequence_in_range(const u16string &query, const u16string &extra_word_characters,
+                                               Range range, const WordIndex *word_index,
+                                               std::unordered_map<u16string, vector<Point>> *substring_matches) {
+    Point start = clip_position(range.start).position;
+    Point end = clip_position(range.end).position;
+    Point last_row_end = clip_position(Point(end.row, UINT32_MAX)).position;
+
+    if (word_index && word_index->extra_word_characters() == extra_word_characters &&
+        (start.row < end.row || (start.column == 0 && end == last_row_end))) {
+      uint32_t first_indexed_row = start.row;
+      if (start.column > 0) {
+        scan_words_with_subsequence(query, extra_word_characters, start,
+                                    clip_position(Point(start.row, UINT32_MAX)).position, substring_matches);
+        first_indexed_row++;
+      }
 
-    static const unsigned consecutive_bonus = 5;
-    static const unsigned subword_start_with_case_match_bonus = 10;
-    static const unsigned subword_start_with_case_mismatch_bonus = 9;
-    static const unsigned mismatch_penalty = 1;
-    static const unsigned leading_mismatch_penalty = 3;
+      uint32_t end_indexed_row = end == last_row_end ? end.row + 1 : end.row;
+      if (first_indexed_row < end_indexed_row) {
+        word_index->find_words_with_subsequence(query, first_indexed_row, end_indexed_row, substring_matches);
+      }
 
-    vector<SubsequenceMatch> matches;
+      if (end != last_row_end) {
+        scan_words_with_subsequence(query, extra_word_characters, Point(end.row, 0), end, substring_matches);
+      }
+    } else {
+      scan_words_with_subsequence(query, extra_word_characters, start, end, substring_matches);
+    }
+  }
 
-    for (auto entry : substring_matches) {
-      const u16string &word = entry.first;
-      const vector<Point> &start_positions = entry.second;
-
-      vector<SubsequenceMatchVariant> match_variants {{}};
-      vector<SubsequenceMatchVariant> new_match_variants;
-
-      for (size_t i = 0; i < word.size(); i++) {
-        uint16_t c = towlower(word[i]);
-
-        for (auto match_variant = match_variants.begin(); match_variant != match_variants.end();) {
-          if (match_variant->query_index < query.size()) {
-            // If the current word character matches the next character of
-            // the query for this match variant, create a *new* match variant
-            // that consumes the matching character.
-            if (c == query[match_variant->query_index]) {
-              SubsequenceMatchVariant new_match = *match_variant;
-              new_match.query_index++;
-
-              if (i == 0 ||
-                  !std::iswalnum(word[i - 1]) ||
-                  (std::iswlower(word[i - 1]) && std::iswupper(word[i]))) {
-                new_match.score += word[i] == raw_query[match_variant->query_index]
-                  ? subword_start_with_case_match_bonus
-                  : subword_start_with_case_mismatch_bonus;
-              }
+  vector<SubsequenceMatch> find_words_with_subsequence_in_range(const u16string &query, const u16string &extra_word_characters,
+                                                                Range range, size_t max_count,
+                                                                const WordIndex *word_index = nullptr) {
+    if (query.size() > WordIndex::MAX_WORD_LENGTH || max_count == 0) return vector<SubsequenceMatch>{};
 
-              if (!new_match.match_indices.empty() && new_match.match_indices.back() == i - 1) {
-                new_match.score += consecutive_bonus;
-              }
+    u16string lowercase_query = query;
+    std::transform(lowercase_query.begin(), lowercase_query.end(), lowercase_query.begin(), std::towlower);
 
-              new_match.match_indices.push_back(i);
-              new_match_variants.push_back(new_match);
-            }
+    std::unordered_map<u16string, vector<Point>> substring_matches;
+    collect_words_with_subsequence_in_range(lowercase_query, extra_word_characters, range, word_index, &substring_matches);
 
-            // For the current match variant, treat the current character as
-            // a mismatch regardless of whether it matched above. This
-            // reserves the chance for the next character to be consumed by a
-            // match with higher overall value.
-            if (i < 3) {
-              match_variant->score -= leading_mismatch_penalty;
-            } else {
-              match_variant->score -= mismatch_penalty;
-            }
+    TopMatches<SubsequenceMatch> matches(max_count);
+    for (auto &entry : substring_matches) {
+      const u16string &word = entry.first;
+      if (matches.is_full() && !matches.could_include(word, WordIndex::max_match_score(word, lowercase_query))) continue;
 
-            // If a match variant does *not* match the current character (and is therefore
-            // ineligible for the consecutive match bonus on the next character), its
-            // potential for future scoring is determined entirely by its `query_index`.
-            //
-            // These match variants are ordered by ascending `query_index`. If multiple
-            // match variants have the same `query_index`, they are ordered by ascending
-            // `score`.
-            //
-            // If there is another match variant with the same `query_index` and a greater
-            // or equal `score`, discard the current match variant.
-            auto next_match_variant = match_variant + 1;
-            if (next_match_variant != match_variants.end() && next_match_variant->query_index == match_variant->query_index) {
-              match_variant = match_variants.erase(match_variant);
-            } else {
-              ++match_variant;
-            }
-          } else {
-            ++match_variant;
-          }
-        }
+      SubsequenceMatch match{word, {}, {}, 0};
+      match.score = WordIndex::score_match(word, query, lowercase_query, &match.match_indices);
+      if (!matches.could_include(word, match.score)) continue;
+      match.positions = move(entry.second);
+      matches.add(move(match));
+    }
 
-        // Add all of the newly-computed match variants to the list. Avoid creating duplicate
-        // match variants with the same query index unless the new variant (which is
-        // by definition eligible for the consecutive match bonus on the next character) has
-        // a lower score than an existing variant. Maintain the invariant that match variants
-        // are ordered by ascending `query_index` and ascending `score`.
-        for (const SubsequenceMatchVariant &new_variant : new_match_variants) {
-          auto existing_match_iter = std::lower_bound(match_variants.begin(), match_variants.end(), new_variant);
-          if (existing_match_iter != match_variants.end() && new_variant.query_index == existing_match_iter->query_index) {
-            if (new_variant.score >= existing_match_iter->score) {
-              *existing_match_iter = new_variant;
-              continue;
-            }
-          }
-          match_variants.insert(existing_match_iter, new_variant);
-        }
-        new_match_variants.clear();
-      }
+    return matches.take();
+  }
 
-      SubsequenceMatchVariant *best_match = nullptr;
-      for (auto &match_variant : match_variants) {
-        if (match_variant.query_index == query.size()) {
-          if (!best_match || best_match->score < match_variant.score) {
-            best_match = &match_variant;
-          }
-        }
-      }
+  void serialize_changes(const Layer *base_layer, Serializer &serializer) {
+    serializer.append(size_);
+    extent_.serialize(serializer);
+    if (this == base_layer) {
+      Patch().serialize(serializer);
+      return;
+    }
 
-      matches.push_back(SubsequenceMatch{word, start_positions, best_match->match_indices, best_match->score});
+    if (previous_layer == base_layer) {
+      patch.serialize(serializer);
+      return;
     }
 
-    std::sort(matches.begin(), matches.end(), [] (const SubsequenceMatch &a, const SubsequenceMatch &b) {
-      // Doing it this way helps us avoid sorting ambiguity keeping the ordering the same across platforms.
-      if (a.score > b.score) return true;
-      if (b.score > a.score) return false;
-      return a.word < b.word;
-    });
+    vector<const Patch *> patches;
+    const Layer *layer = this;
+    while (layer != base_layer) {
+      patches.insert(patches.begin(), &layer->patch);
+      layer = layer->previous_layer;
+    }
 
-    return matches;
+    Patch combination;
+    bool left_to_right = true;
+    for (const Patch *patch : patches) {
+      combination.combine(*patch, left_to_right);
+      left_to_right = !left_to_right;
+    }
+    combination.serialize(serializer);
   }
 
   bool is_modified(const Layer *base_layer) {
@@ -691,6 +723,8 @@ TextBuffer::TextBuffer(const std::u16string &text) :
   TextBuffer{u16string{text.begin(), text.end()}} {}
 
 void TextBuffer::reset(Text &&new_base_text) {
+  word_index.reset();
+
   bool has_snapshot = false;
   auto layer = top_layer;
   while (layer) {
@@ -754,36 +788,12 @@ Patch TextBuffer::get_inverted_changes(const Snapshot *snapshot) const {
 }
 
 void TextBuffer::serialize_changes(Serializer &serializer) {
-  serializer.append(top_layer->size_);
-  top_layer->extent_.serialize(serializer);
-  if (top_layer == base_layer) {
-    Patch().serialize(serializer);
-    return;
-  }
-
-  if (top_layer->previous_layer == base_layer) {
-    top_layer->patch.serialize(serializer);
-    return;
-  }
-
-  vector<const Patch *> patches;
-  Layer *layer = top_layer;
-  while (layer != base_layer) {
-    patches.insert(patches.begin(), &layer->patch);
-    layer = layer->previous_layer;
-  }
-
-  Patch combination;
-  bool left_to_right = true;
-  for (const Patch *patch : patches) {
-    combination.combine(*patch, left_to_right);
-    left_to_right = !left_to_right;
-  }
-  combination.serialize(serializer);
+  top_layer->serialize_changes(base_layer, serializer);
 }
 
 bool TextBuffer::deserialize_changes(Deserializer &deserializer) {
   if (top_layer != base_layer || base_layer->previous_layer) return false;
+  word_index.reset();
   top_layer = new Layer(base_layer);
   top_layer->size_ = deserializer.read<uint32_t>();
   top_layer->extent_ = Point(deserializer);
@@ -911,6 +921,7 @@ void TextBuffer::set_text_in_range(Range old_range, u16string &&string) {
     move(new_text),
     deleted_text_size
   );
+  update_word_index(start.position, deleted_extent, new_range_end);
 
   auto change = top_layer->patch.grab_change_starting_before_new_position(start.position);
   if (change && change->old_text_size == change->new_text->size()) {
@@ -942,11 +953,33 @@ vector<Range> TextBuffer::find_all(const Regex &regex, Range range) const {
   return top_layer->find_all_in_range(regex, range, false);
 }
 
+void TextBuffer::find_each(const Regex &regex, const std::function<bool(Range)> &callback, Range range) const {
+  top_layer->scan_in_range(regex, range, [&callback](Range match_range, uint32_t) -> bool {
+    return callback(match_range);
+  }, false);
+}
+
+void TextBuffer::find_each_prioritized(const Regex &regex, Range priority_range,
+                                       const std::function<bool(Range)> &callback,
+                                       const std::function<void()> &part_callback, Range range) const {
+  top_layer->scan_in_range_prioritized(regex, range, priority_range, [&callback](Range match_range, uint32_t) -> bool {
+    return callback(match_range);
+  }, part_callback);
+}
+
+vector<TextBuffer::PatternMatch> TextBuffer::find_all_multi(const Regex &regex, Range range) const {
+  return top_layer->find_all_multi_in_range(regex, range, false);
+}
+
 unsigned TextBuffer::find_and_mark_all(MarkerIndex &index, MarkerIndex::MarkerId next_id,
                                        bool exclusive, const Regex &regex, Range range) const {
   return top_layer->find_and_mark_all_in_range(index, next_id, exclusive, regex, range, false);
 }
 
+bool TextBuffer::PatternMatch::operator==(const PatternMatch &other) const {
+  return pattern_index == other.pattern_index && range == other.range;
+}
+
 bool TextBuffer::SubsequenceMatch::operator==(const SubsequenceMatch &other) const {
   return (
     word == other.word &&
@@ -956,8 +989,36 @@ bool TextBuffer::SubsequenceMatch::operator==(const SubsequenceMatch &other) con
   );
 }
 
-vector<SubsequenceMatch> TextBuffer::find_words_with_subsequence_in_range(const u16string &query, const u16string &non_word_characters, Range range) const {
-  return top_layer->find_words_with_subsequence_in_range(query, non_word_characters, range);
+// The first query builds an index of the buffer's words, which edits then keep
+// up to date, so that later queries don't need to scan the whole buffer.
+vector<SubsequenceMatch> TextBuffer::find_words_with_subsequence_in_range(const u16string &query, const u16string &extra_word_characters, Range range,
+                                                                         size_t max_count) const {
+  if (WordIndex::supports_word_characters(extra_word_characters) &&
+      (!word_index || word_index->extra_word_characters() != extra_word_characters)) {
+    word_index = std::make_shared<WordIndex>(extra_word_characters, top_layer->text_in_range(Range{Point(), extent()}));
+  }
+  return top_layer->find_words_with_subsequence_in_range(query, extra_word_characters, range, max_count, word_index.get());
+}
+
+// Takes over the word index built by a snapshot's query, as long as the buffer
+// hasn't changed since the snapshot was taken.
+bool TextBuffer::adopt_word_index(const Snapshot *snapshot) {
+  if (!snapshot->word_index || snapshot->word_index == word_index || &snapshot->layer != top_layer) return false;
+  word_index = snapshot->word_index;
+  return true;
+}
+
+void TextBuffer::update_word_index(Point start, Point deleted_extent, Point new_range_end) {
+  if (!word_index) return;
+
+  // Snapshots share the index with the buffer, and may be reading it on
+  // another thread.
+  if (word_index.use_count() > 1) word_index = std::make_shared<WordIndex>(*word_index);
+  word_index->splice(
+    start.row,
+    deleted_extent.row,
+    top_layer->text_in_range(Range{Point(start.row, 0), Point(new_range_end.row, UINT32_MAX)})
+  );
 }
 
 bool TextBuffer::is_modified() const {
@@ -1009,7 +1070,9 @@ size_t TextBuffer::layer_count() const {
 TextBuffer::Snapshot *TextBuffer::create_snapshot() {
   top_layer->snapshot_count++;
   base_layer->snapshot_count++;
-  return new Snapshot(*this, *top_layer, *base_layer);
+  Snapshot *snapshot = new Snapshot(*this, *top_layer, *base_layer);
+  snapshot->word_index = word_index;
+  return snapshot;
 }
 
 void TextBuffer::flush_changes() {
@@ -1060,8 +1123,50 @@ vector<Range> TextBuffer::Snapshot::find_all(const Regex &regex, Range range) co
   return layer.find_all_in_range(regex, range, false);
 }
 
-vector<SubsequenceMatch> TextBuffer::Snapshot::find_words_with_subsequence_in_range(std::u16string query, const std::u16string &extra_word_characters, Range range) const {
-  return layer.find_words_with_subsequence_in_range(query, extra_word_characters, range);
+void TextBuffer::Snapshot::find_each(const Regex &regex, const std::function<bool(Range)> &callback,
+                                     Range range) const {
+  layer.scan_in_range(regex, range, [&callback](Range match_range, uint32_t) -> bool {
+    return callback(match_range);
+  }, false);
+}
+
+void TextBuffer::Snapshot::find_each_prioritized(const Regex &regex, Range priority_range,
+                                                 const std::function<bool(Range)> &callback,
+                                                 const std::function<void()> &part_callback, Range range) const {
+  layer.scan_in_range_prioritized(regex, range, priority_range, [&callback](Range match_range, uint32_t) -> bool {
+    return callback(match_range);
+  }, part_callback);
+}
+
+vector<TextBuffer::PatternMatch> TextBuffer::Snapshot::find_all_multi(const Regex &regex, Range range) const {
+  return layer.find_all_multi_in_range(regex, range, false);
+}
+
+vector<SubsequenceMatch> TextBuffer::Snapshot::find_words_with_subsequence_in_range(std::u16string query, const std::u16string &extra_word_characters, Range range,
+                                                                                   size_t max_count) const {
+  return layer.find_words_with_subsequence_in_range(query, extra_word_characters, range, max_count, get_word_index(extra_word_characters));
+}
+
+// Adds the start positions of the words that contain `lowercase_query` as a
+// subsequence, leaving the scoring to the caller. This lets the matches of
+// several buffers be merged before each distinct word is scored.
+void TextBuffer::Snapshot::collect_words_with_subsequence(const u16string &lowercase_query, const u16string &extra_word_characters,
+                                                          std::unordered_map<u16string, vector<Point>> *result) const {
+  if (lowercase_query.size() > WordIndex::MAX_WORD_LENGTH) return;
+  layer.collect_words_with_subsequence_in_range(lowercase_query, extra_word_characters, Range{Point(), extent()},
+                                                get_word_index(extra_word_characters), result);
+}
+
+const WordIndex *TextBuffer::Snapshot::get_word_index(const u16string &extra_word_characters) const {
+  if (WordIndex::supports_word_characters(extra_word_characters) &&
+      (!word_index || word_index->extra_word_characters() != extra_word_characters)) {
+    word_index = std::make_shared<WordIndex>(extra_word_characters, text());
+  }
+  return word_index.get();
+}
+
+void TextBuffer::Snapshot::serialize_changes(Serializer &serializer) const {
+  layer.serialize_changes(&base_layer, serializer);
 }
 
 const Text &TextBuffer::Snapshot::base_text() const {
@@ -1,7 +1,10 @@
 #ifndef SUPERSTRING_TEXT_BUFFER_H_
 #define SUPERSTRING_TEXT_BUFFER_H_
 
+#include <functional>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "text.h"
 #include "patch.h"
@@ -10,12 +13,16 @@
 #include "regex.h"
 #include "marker-index.h"
 
+class WordIndex;
+
 class TextBuffer {
   struct Layer;
   Layer *base_layer;
   Layer *top_layer;
+  mutable std::shared_ptr<WordIndex> word_index;
   void squash_layers(const std::vector<Layer *> &);
   void consolidate_layers();
+  void update_word_index(Point start, Point deleted_extent, Point new_range_end);
 
 public:
   static uint32_t MAX_CHUNK_SIZE_TO_COPY;
@@ -53,9 +60,33 @@ public:
 
   optional<Range> find(const Regex &, Range range = Range::all_inclusive()) const;
   std::vector<Range> find_all(const Regex &, Range range = Range::all_inclusive()) const;
+
+  // Calls `callback` with each match in turn, stopping early if it returns
+  // true, so that the matches can be handled before the search completes.
+  void find_each(const Regex &, const std::function<bool(Range)> &callback,
+                 Range range = Range::all_inclusive()) const;
+
+  // Like find_each, but searches the rows of `priority_range` first, then the
+  // rows below them and then the rows above them, calling `part_callback`
+  // after each of those parts. Each part is searched on its own, so matches
+  // can't cross the line breaks between them, and each match belongs to the
+  // part that it starts in.
+  void find_each_prioritized(const Regex &, Range priority_range, const std::function<bool(Range)> &callback,
+                             const std::function<void()> &part_callback,
+                             Range range = Range::all_inclusive()) const;
   unsigned find_and_mark_all(MarkerIndex &, MarkerIndex::MarkerId, bool exclusive,
                              const Regex &, Range range = Range::all_inclusive()) const;
 
+  struct PatternMatch {
+    uint32_t pattern_index;
+    Range range;
+    bool operator==(const PatternMatch &) const;
+  };
+
+  // Finds the matches of a regex built from several patterns in a single pass,
+  // along with the index of the pattern that each one matched.
+  std::vector<PatternMatch> find_all_multi(const Regex &, Range range = Range::all_inclusive()) const;
+
   struct SubsequenceMatch {
     std::u16string word;
     std::vector<Point> positions;
@@ -64,15 +95,18 @@ public:
     bool operator==(const SubsequenceMatch &) const;
   };
 
-  std::vector<SubsequenceMatch> find_words_with_subsequence_in_range(const std::u16string &, const std::u16string &, Range) const;
+  std::vector<SubsequenceMatch> find_words_with_subsequence_in_range(const std::u16string &, const std::u16string &, Range,
+                                                                     size_t max_count = SIZE_MAX) const;
 
   class Snapshot {
     friend class TextBuffer;
     TextBuffer &buffer;
     Layer &layer;
     Layer &base_layer;
+    mutable std::shared_ptr<WordIndex> word_index;
 
     Snapshot(TextBuffer &, Layer &, Layer &);
+    const WordIndex *get_word_index(const std::u16string &extra_word_characters) const;
 
   public:
     ~Snapshot();
@@ -89,12 +123,23 @@ public:
     const Text &base_text() const;
     optional<Range> find(const Regex &, Range range = Range::all_inclusive()) const;
     std::vector<Range> find_all(const Regex &, Range range = Range::all_inclusive()) const;
-    std::vector<SubsequenceMatch> find_words_with_subsequence_in_range(std::u16string query, const std::u16string &extra_word_characters, Range range) const;
+    void find_each(const Regex &, const std::function<bool(Range)> &callback,
+                   Range range = Range::all_inclusive()) const;
+    void find_each_prioritized(const Regex &, Range priority_range, const std::function<bool(Range)> &callback,
+                               const std::function<void()> &part_callback,
+                               Range range = Range::all_inclusive()) const;
+    std::vector<PatternMatch> find_all_multi(const Regex &, Range range = Range::all_inclusive()) const;
+    std::vector<SubsequenceMatch> find_words_with_subsequence_in_range(std::u16string query, const std::u16string &extra_word_characters, Range range,
+                                                                       size_t max_count = SIZE_MAX) const;
+    void collect_words_with_subsequence(const std::u16string &lowercase_query, const std::u16string &extra_word_characters,
+                                        std::unordered_map<std::u16string, std::vector<Point>> *) const;
+    void serialize_changes(Serializer &) const;
   };
 
   friend class Snapshot;
   Snapshot *create_snapshot();
 
+  bool adopt_word_index(const Snapshot *);
   bool is_modified(const Snapshot *) const;
   Patch get_inverted_changes(const Snapshot *) const;
 
@@ -44,19 +44,16 @@ Text::Text(const u16string &&content, const vector<uint32_t> &&line_offsets) :
 
 Text::Text(Deserializer &deserializer) : line_offsets{0} {
   uint32_t size = deserializer.read<uint32_t>();
-  content.reserve(size);
+  content.resize(size);
+  deserializer.read_array(reinterpret_cast<uint16_t *>(&content[0]), size);
   for (uint32_t offset = 0; offset < size; offset++) {
-    uint16_t character = deserializer.read<uint16_t>();
-    content.push_back(character);
-    if (character == '\n') line_offsets.push_back(offset + 1);
+    if (content[offset] == '\n') line_offsets.push_back(offset + 1);
   }
 }
 
 void Text::serialize(Serializer &serializer) const {
   serializer.append<uint32_t>(size());
-  for (uint16_t character : content) {
-    serializer.append<uint16_t>(character);
-  }
+  serializer.append_array(reinterpret_cast<const uint16_t *>(content.data()), size());
 }
 
 Point Text::extent(const std::u16string &string) {
@@ -0,0 +1,149 @@
+#include "word-corpus.h"
+#include "word-index.h"
+#include <algorithm>
+#include <cwctype>
+#include <future>
+#include <thread>
+#include <unordered_map>
+
+using std::pair;
+using std::u16string;
+using std::unordered_map;
+using std::vector;
+using Match = WordCorpus::Match;
+
+// Scoring a word takes a few microseconds, so there is no point in handing
+// fewer than this many words to a thread of their own.
+static const size_t MIN_WORDS_PER_SCORING_TASK = 256;
+
+// The number of threads to use for `item_count` items, with at least
+// `min_items_per_task` items on each.
+static size_t get_task_count(size_t item_count, unsigned thread_count, size_t min_items_per_task) {
+  return std::max<size_t>(1, std::min<size_t>(thread_count, (item_count + min_items_per_task - 1) / min_items_per_task));
+}
+
+// Calls `callback` with every task index below `task_count`, each on its own
+// thread except for the first, which runs on the calling thread.
+template <typename Callback>
+static void run_tasks_in_parallel(size_t task_count, const Callback &callback) {
+  vector<std::future<void>> tasks;
+  for (size_t task_index = 1; task_index < task_count; task_index++) {
+    tasks.push_back(std::async(std::launch::async, [&callback, task_index] { callback(task_index); }));
+  }
+  callback(0);
+  for (auto &task : tasks) task.get();
+}
+
+bool WordCorpus::Match::operator==(const Match &other) const {
+  return (
+    word == other.word &&
+    positions == other.positions &&
+    match_indices == other.match_indices &&
+    score == other.score
+  );
+}
+
+WordCorpus::WordCorpus() : next_buffer_id{1} {}
+
+WordCorpus::BufferId WordCorpus::add_buffer(TextBuffer *buffer) {
+  for (const auto &entry : buffers) {
+    if (entry.second == buffer) return entry.first;
+  }
+  BufferId id = next_buffer_id++;
+  buffers.push_back({id, buffer});
+  return id;
+}
+
+bool WordCorpus::remove_buffer(BufferId id) {
+  for (auto iter = buffers.begin(); iter != buffers.end(); ++iter) {
+    if (iter->first == id) {
+      buffers.erase(iter);
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t WordCorpus::buffer_count() const {
+  return buffers.size();
+}
+
+WordCorpus::Snapshot *WordCorpus::create_snapshot() {
+  return new Snapshot(buffers);
+}
+
+vector<Match> WordCorpus::find_words_with_subsequence(const u16string &query, const u16string &extra_word_characters,
+                                                      size_t max_count, unsigned thread_count) {
+  Snapshot snapshot(buffers);
+  return snapshot.find_words_with_subsequence(query, extra_word_characters, max_count, thread_count);
+}
+
+WordCorpus::Snapshot::Snapshot(const vector<pair<BufferId, TextBuffer *>> &buffers) : buffers{buffers} {
+  for (const auto &entry : buffers) {
+    buffer_snapshots.push_back(entry.second->create_snapshot());
+  }
+}
+
+WordCorpus::Snapshot::~Snapshot() {
+  for (size_t i = 0; i < buffers.size(); i++) {
+    buffers[i].second->adopt_word_index(buffer_snapshots[i]);
+    delete buffer_snapshots[i];
+  }
+}
+
+vector<Match> WordCorpus::Snapshot::find_words_with_subsequence(const u16string &query,
+                                                                const u16string &extra_word_characters,
+                                                                size_t max_count, unsigned thread_count) const {
+  if (thread_count == 0) thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+  u16string lowercase_query = query;
+  std::transform(lowercase_query.begin(), lowercase_query.end(), lowercase_query.begin(), std::towlower);
+
+  // First, find the matching words of each buffer. The buffer snapshots are
+  // independent of each other, so each one can be searched, and have its word
+  // index built if needed, on a separate thread.
+  vector<unordered_map<u16string, vector<Point>>> words_by_buffer(buffer_snapshots.size());
+  size_t task_count = get_task_count(buffer_snapshots.size(), thread_count, 1);
+  run_tasks_in_parallel(task_count, [&] (size_t task_index) {
+    for (size_t i = task_index; i < buffer_snapshots.size(); i += task_count) {
+      buffer_snapshots[i]->collect_words_with_subsequence(lowercase_query, extra_word_characters, &words_by_buffer[i]);
+    }
+  });
+
+  // Next, merge the words that occur in several buffers.
+  vector<Match> matches;
+  unordered_map<u16string, size_t> match_indices_by_word;
+  for (size_t i = 0; i < words_by_buffer.size(); i++) {
+    for (auto &entry : words_by_buffer[i]) {
+      auto inserted = match_indices_by_word.insert({entry.first, matches.size()});
+      if (inserted.second) matches.push_back(Match{entry.first, {}, {}, 0});
+      matches[inserted.first->second].positions.push_back({buffers[i].first, std::move(entry.second)});
+    }
+  }
+
+  // Then score the distinct words, with each task keeping its own best
+  // matches and skipping the words that can't beat them, and combine the
+  // results.
+  task_count = get_task_count(matches.size(), thread_count, MIN_WORDS_PER_SCORING_TASK);
+  vector<TopMatches<Match>> top_matches_by_task(task_count, TopMatches<Match>(max_count));
+  run_tasks_in_parallel(task_count, [&] (size_t task_index) {
+    TopMatches<Match> &top_matches = top_matches_by_task[task_index];
+    for (size_t i = task_index; i < matches.size(); i += task_count) {
+      Match &match = matches[i];
+      if (top_matches.is_full() &&
+          !top_matches.could_include(match.word, WordIndex::max_match_score(match.word, lowercase_query))) continue;
+      match.score = WordIndex::score_match(match.word, query, lowercase_query, &match.match_indices);
+      top_matches.add(std::move(match));
+    }
+  });
+
+  if (task_count == 1) return top_matches_by_task[0].take();
+
+  TopMatches<Match> top_matches(max_count);
+  for (auto &task_top_matches : top_matches_by_task) {
+    for (Match &match : task_top_matches.take()) {
+      top_matches.add(std::move(match));
+    }
+  }
+  return top_matches.take();
+}
@@ -0,0 +1,64 @@
+#ifndef SUPERSTRING_WORD_CORPUS_H_
+#define SUPERSTRING_WORD_CORPUS_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "point.h"
+#include "text-buffer.h"
+
+// A set of buffers whose words are searched together. A word that occurs in
+// several buffers is scored once, and the best matches are chosen across all
+// of the buffers rather than per buffer.
+class WordCorpus {
+public:
+  using BufferId = uint32_t;
+
+  struct Match {
+    std::u16string word;
+    std::vector<std::pair<BufferId, std::vector<Point>>> positions;
+    std::vector<uint32_t> match_indices;
+    int32_t score;
+    bool operator==(const Match &) const;
+  };
+
+  class Snapshot;
+
+  WordCorpus();
+
+  BufferId add_buffer(TextBuffer *);
+  bool remove_buffer(BufferId);
+  size_t buffer_count() const;
+
+  Snapshot *create_snapshot();
+
+  // Returns up to `max_count` of the words that contain `query` as a
+  // subsequence, best first, along with their positions in each buffer.
+  // Passing a `thread_count` of 0 uses one thread per available core.
+  std::vector<Match> find_words_with_subsequence(const std::u16string &query, const std::u16string &extra_word_characters,
+                                                 size_t max_count, unsigned thread_count = 0);
+
+private:
+  std::vector<std::pair<BufferId, TextBuffer *>> buffers;
+  BufferId next_buffer_id;
+};
+
+// Snapshots of every buffer in a corpus, which can be queried on a background
+// thread. Like the buffer snapshots it holds, a corpus snapshot must be
+// destroyed on the thread that owns the buffers, which then take over any word
+// indices that its queries built.
+class WordCorpus::Snapshot {
+  friend class WordCorpus;
+  std::vector<std::pair<BufferId, TextBuffer *>> buffers;
+  std::vector<TextBuffer::Snapshot *> buffer_snapshots;
+
+  explicit Snapshot(const std::vector<std::pair<BufferId, TextBuffer *>> &);
+
+public:
+  ~Snapshot();
+
+  std::vector<Match> find_words_with_subsequence(const std::u16string &query, const std::u16string &extra_word_characters,
+                                                 size_t max_count, unsigned thread_count = 0) const;
+};
+
+#endif // SUPERSTRING_WORD_CORPUS_H_
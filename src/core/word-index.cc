@@ -0,0 +1,379 @@
+#include "word-index.h"
+#include <algorithm>
+#include <bitset>
+#include <cassert>
+#include <cwctype>
+
+using std::u16string;
+using std::unordered_map;
+using std::vector;
+
+namespace {
+
+static const uint8_t NO_MATCH_INDEX = UINT8_MAX;
+
+// The matched characters are stored inline, since variants are copied each
+// time they consume a character.
+struct SubsequenceMatchVariant {
+  uint8_t query_index = 0;
+  uint8_t last_match_index = NO_MATCH_INDEX;
+  int16_t score = 0;
+  std::bitset<WordIndex::MAX_WORD_LENGTH> match_indices;
+
+  bool operator<(const SubsequenceMatchVariant &other) const {
+    return query_index < other.query_index;
+  }
+};
+
+static bool is_subword_start(const u16string &word, size_t i) {
+  return
+    i == 0 ||
+    !std::iswalnum(word[i - 1]) ||
+    (std::iswlower(word[i - 1]) && std::iswupper(word[i]));
+}
+
+static const unsigned consecutive_bonus = 5;
+static const unsigned subword_start_with_case_match_bonus = 10;
+static const unsigned subword_start_with_case_mismatch_bonus = 9;
+static const unsigned mismatch_penalty = 1;
+static const unsigned leading_mismatch_penalty = 3;
+
+}  // namespace
+
+int32_t WordIndex::score_match(const u16string &word, const u16string &query, const u16string &lowercase_query,
+                               vector<uint32_t> *match_indices) {
+  assert(word.size() <= MAX_WORD_LENGTH);
+
+  vector<SubsequenceMatchVariant> match_variants {{}};
+  vector<SubsequenceMatchVariant> new_match_variants;
+
+  for (size_t i = 0; i < word.size(); i++) {
+    uint16_t c = towlower(word[i]);
+
+    for (auto match_variant = match_variants.begin(); match_variant != match_variants.end();) {
+      if (match_variant->query_index < query.size()) {
+        // If the current word character matches the next character of
+        // the query for this match variant, create a *new* match variant
+        // that consumes the matching character.
+        if (c == lowercase_query[match_variant->query_index]) {
+          SubsequenceMatchVariant new_match = *match_variant;
+          new_match.query_index++;
+
+          if (is_subword_start(word, i)) {
+            new_match.score += word[i] == query[match_variant->query_index]
+              ? subword_start_with_case_match_bonus
+              : subword_start_with_case_mismatch_bonus;
+          }
+
+          if (new_match.last_match_index != NO_MATCH_INDEX && new_match.last_match_index == i - 1) {
+            new_match.score += consecutive_bonus;
+          }
+
+          new_match.match_indices.set(i);
+          new_match.last_match_index = i;
+          new_match_variants.push_back(new_match);
+        }
+
+        // For the current match variant, treat the current character as
+        // a mismatch regardless of whether it matched above. This
+        // reserves the chance for the next character to be consumed by a
+        // match with higher overall value.
+        if (i < 3) {
+          match_variant->score -= leading_mismatch_penalty;
+        } else {
+          match_variant->score -= mismatch_penalty;
+        }
+
+        // If a match variant does *not* match the current character (and is therefore
+        // ineligible for the consecutive match bonus on the next character), its
+        // potential for future scoring is determined entirely by its `query_index`.
+        //
+        // These match variants are ordered by ascending `query_index`. If multiple
+        // match variants have the same `query_index`, they are ordered by ascending
+        // `score`.
+        //
+        // If there is another match variant with the same `query_index` and a greater
+        // or equal `score`, discard the current match variant.
+        auto next_match_variant = match_variant + 1;
+        if (next_match_variant != match_variants.end() && next_match_variant->query_index == match_variant->query_index) {
+          match_variant = match_variants.erase(match_variant);
+        } else {
+          ++match_variant;
+        }
+      } else {
+        ++match_variant;
+      }
+    }
+
+    // Add all of the newly-computed match variants to the list. Avoid creating duplicate
+    // match variants with the same query index unless the new variant (which is
+    // by definition eligible for the consecutive match bonus on the next character) has
+    // a lower score than an existing variant. Maintain the invariant that match variants
+    // are ordered by ascending `query_index` and ascending `score`.
+    for (const SubsequenceMatchVariant &new_variant : new_match_variants) {
+      auto existing_match_iter = std::lower_bound(match_variants.begin(), match_variants.end(), new_variant);
+      if (existing_match_iter != match_variants.end() && new_variant.query_index == existing_match_iter->query_index) {
+        if (new_variant.score >= existing_match_iter->score) {
+          *existing_match_iter = new_variant;
+          continue;
+        }
+      }
+      match_variants.insert(existing_match_iter, new_variant);
+    }
+    new_match_variants.clear();
+  }
+
+  SubsequenceMatchVariant *best_match = nullptr;
+  for (auto &match_variant : match_variants) {
+    if (match_variant.query_index == query.size()) {
+      if (!best_match || best_match->score < match_variant.score) {
+        best_match = &match_variant;
+      }
+    }
+  }
+
+  match_indices->clear();
+  if (!best_match) return 0;
+  for (uint32_t i = 0; i < word.size(); i++) {
+    if (best_match->match_indices.test(i)) match_indices->push_back(i);
+  }
+  return best_match->score;
+}
+
+int32_t WordIndex::max_match_score(const u16string &word, const u16string &lowercase_query) {
+  if (lowercase_query.empty()) return 0;
+
+  // Every matched character can at best start a subword and follow another
+  // match, and every character skipped before the last match costs at least
+  // the mismatch penalty. The last match can be no earlier than where the
+  // query is first completed by matching characters greedily.
+  size_t subword_start_count = 0;
+  size_t query_index = 0;
+  size_t first_completion_index = 0;
+  for (size_t i = 0; i < word.size(); i++) {
+    if (is_subword_start(word, i)) subword_start_count++;
+    if (query_index < lowercase_query.size() &&
+        static_cast<char16_t>(std::towlower(word[i])) == lowercase_query[query_index]) {
+      query_index++;
+      if (query_index == lowercase_query.size()) first_completion_index = i;
+    }
+  }
+
+  int32_t query_size = lowercase_query.size();
+  int32_t subword_start_match_count = std::min<int32_t>(query_size, subword_start_count);
+  int32_t skipped_count = first_completion_index + 1 - query_size;
+  return
+    static_cast<int32_t>(subword_start_with_case_match_bonus) * subword_start_match_count +
+    static_cast<int32_t>(consecutive_bonus) * (query_size - 1) -
+    static_cast<int32_t>(mismatch_penalty) * skipped_count;
+}
+
+// Lowercases ASCII characters without going through `towlower`, which
+// otherwise dominates the cost of matching words against a query.
+static char16_t fold_character(char16_t c) {
+  if (c < 128) return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+  return std::towlower(c);
+}
+
+// A bit for each distinct lowercased character. Letters and digits get their
+// own bits, and the other characters share the remaining ones.
+static uint64_t get_signature(const char16_t *characters, size_t length) {
+  uint64_t signature = 0;
+  for (size_t i = 0; i < length; i++) {
+    char16_t c = fold_character(characters[i]);
+    if (c >= 'a' && c <= 'z') {
+      signature |= uint64_t(1) << (c - 'a');
+    } else if (c >= '0' && c <= '9') {
+      signature |= uint64_t(1) << (26 + c - '0');
+    } else {
+      signature |= uint64_t(1) << (36 + c % 28);
+    }
+  }
+  return signature;
+}
+
+bool WordIndex::supports_word_characters(const u16string &extra_word_characters) {
+  return extra_word_characters.find_first_of(u"\r\n") == u16string::npos;
+}
+
+WordIndex::WordIndex(const u16string &extra_word_characters, const u16string &text) :
+  extra_word_characters_{extra_word_characters}, unused_folded_character_count{0} {
+  for (uint16_t c = 0; c < 128; c++) {
+    ascii_word_characters[c] =
+      std::iswalnum(c) ||
+      extra_word_characters.find(c) != u16string::npos;
+  }
+  lines = tokenize(text);
+}
+
+const u16string &WordIndex::extra_word_characters() const {
+  return extra_word_characters_;
+}
+
+uint32_t WordIndex::line_count() const {
+  return lines.size();
+}
+
+size_t WordIndex::word_count() const {
+  return word_ids.size();
+}
+
+void WordIndex::splice(uint32_t start_row, uint32_t deleted_row_count, const u16string &inserted_text) {
+  if (start_row >= lines.size()) return;
+  uint32_t end_row = std::min<uint32_t>(start_row + deleted_row_count + 1, lines.size());
+  for (uint32_t row = start_row; row < end_row; row++) {
+    remove_words(lines[row]);
+  }
+
+  vector<Line> inserted_lines = tokenize(inserted_text);
+  size_t replaced_line_count = std::min<size_t>(end_row - start_row, inserted_lines.size());
+  std::move(inserted_lines.begin(), inserted_lines.begin() + replaced_line_count, lines.begin() + start_row);
+  if (inserted_lines.size() > replaced_line_count) {
+    lines.insert(
+      lines.begin() + end_row,
+      std::make_move_iterator(inserted_lines.begin() + replaced_line_count),
+      std::make_move_iterator(inserted_lines.end())
+    );
+  } else {
+    lines.erase(lines.begin() + start_row + replaced_line_count, lines.begin() + end_row);
+  }
+}
+
+void WordIndex::find_words_with_subsequence(const u16string &lowercase_query, uint32_t start_row, uint32_t end_row,
+                                            unordered_map<u16string, vector<Point>> *result) const {
+  // Check each distinct word against the query once, then collect the
+  // positions of the words that matched.
+  // Words that lack any of the query's characters are rejected by comparing
+  // signatures, and only the rest are checked character by character.
+  const uint32_t NO_MATCH = UINT32_MAX;
+  vector<uint32_t> match_indices_by_word_id(words.size(), NO_MATCH);
+  vector<vector<Point> *> matches;
+  uint64_t query_signature = get_signature(lowercase_query.data(), lowercase_query.size());
+  for (uint32_t word_id = 0; word_id < words.size(); word_id++) {
+    if ((signatures[word_id] & query_signature) != query_signature) continue;
+    if (occurrence_counts[word_id] == 0) continue;
+
+    const FoldedWord &folded_word = folded_words[word_id];
+    const char16_t *folded_word_characters = folded_characters.data() + folded_word.start;
+    size_t query_index = 0;
+    for (size_t i = 0; i < folded_word.length && query_index < lowercase_query.size(); i++) {
+      if (folded_word_characters[i] == lowercase_query[query_index]) query_index++;
+    }
+
+    if (query_index == lowercase_query.size()) {
+      match_indices_by_word_id[word_id] = matches.size();
+      matches.push_back(&(*result)[words[word_id]]);
+    }
+  }
+
+  if (matches.empty()) return;
+
+  end_row = std::min<uint32_t>(end_row, lines.size());
+  for (uint32_t row = start_row; row < end_row; row++) {
+    for (const Occurrence &occurrence : lines[row]) {
+      uint32_t match_index = match_indices_by_word_id[occurrence.word_id];
+      if (match_index != NO_MATCH) matches[match_index]->push_back(Point(row, occurrence.column));
+    }
+  }
+
+  for (uint32_t word_id = 0; word_id < words.size(); word_id++) {
+    uint32_t match_index = match_indices_by_word_id[word_id];
+    if (match_index != NO_MATCH && matches[match_index]->empty()) result->erase(words[word_id]);
+  }
+}
+
+bool WordIndex::is_word_character(uint16_t c) const {
+  if (c < 128) return ascii_word_characters[c];
+  return std::iswalnum(c) || extra_word_characters_.find(c) != u16string::npos;
+}
+
+vector<WordIndex::Line> WordIndex::tokenize(const u16string &text) {
+  vector<Line> result(1);
+  size_t word_start = 0;
+  bool in_word = false;
+  uint32_t line_start = 0;
+
+  for (size_t i = 0; i <= text.size(); i++) {
+    uint16_t c = i < text.size() ? text[i] : '\n';
+    if (is_word_character(c)) {
+      if (!in_word) {
+        word_start = i;
+        in_word = true;
+      }
+      continue;
+    }
+
+    if (in_word) {
+      size_t length = i - word_start;
+      if (length <= MAX_WORD_LENGTH) {
+        result.back().push_back({add_word(&text[word_start], length), static_cast<uint32_t>(word_start - line_start)});
+      }
+      in_word = false;
+    }
+
+    if (c == '\n' && i < text.size()) {
+      result.emplace_back();
+      line_start = i + 1;
+    }
+  }
+
+  return result;
+}
+
+uint32_t WordIndex::add_word(const char16_t *word, size_t length) {
+  u16string key(word, length);
+  auto iter = word_ids.find(key);
+  if (iter != word_ids.end()) {
+    occurrence_counts[iter->second]++;
+    return iter->second;
+  }
+
+  uint32_t word_id;
+  if (!free_word_ids.empty()) {
+    word_id = free_word_ids.back();
+    free_word_ids.pop_back();
+    words[word_id] = key;
+    signatures[word_id] = get_signature(word, length);
+    occurrence_counts[word_id] = 1;
+  } else {
+    word_id = words.size();
+    words.push_back(key);
+    signatures.push_back(get_signature(word, length));
+    folded_words.push_back({0, 0});
+    occurrence_counts.push_back(1);
+  }
+  store_folded_word(word_id);
+  word_ids.insert({std::move(key), word_id});
+  return word_id;
+}
+
+void WordIndex::remove_words(const Line &line) {
+  for (const Occurrence &occurrence : line) {
+    if (--occurrence_counts[occurrence.word_id] == 0) {
+      word_ids.erase(words[occurrence.word_id]);
+      free_word_ids.push_back(occurrence.word_id);
+      unused_folded_character_count += folded_words[occurrence.word_id].length;
+      folded_words[occurrence.word_id] = {0, 0};
+    }
+  }
+}
+
+// Appends the lowercased word to the shared buffer, first compacting the
+// buffer if most of it belongs to words that have since been removed.
+void WordIndex::store_folded_word(uint32_t word_id) {
+  if (unused_folded_character_count > folded_characters.size() / 2) {
+    u16string compacted_characters;
+    compacted_characters.reserve(folded_characters.size() - unused_folded_character_count);
+    for (FoldedWord &folded_word : folded_words) {
+      uint32_t start = compacted_characters.size();
+      compacted_characters.append(folded_characters, folded_word.start, folded_word.length);
+      folded_word.start = start;
+    }
+    folded_characters = std::move(compacted_characters);
+    unused_folded_character_count = 0;
+  }
+
+  const u16string &word = words[word_id];
+  folded_words[word_id] = {static_cast<uint32_t>(folded_characters.size()), static_cast<uint32_t>(word.size())};
+  for (char16_t c : word) folded_characters.push_back(fold_character(c));
+}
@@ -0,0 +1,126 @@
+#ifndef SUPERSTRING_WORD_INDEX_H_
+#define SUPERSTRING_WORD_INDEX_H_
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "point.h"
+
+// The words of a text, stored line by line as ids into a table of distinct
+// words, so that the lines touched by an edit can be re-tokenized without
+// scanning the rest of the text. Words are runs of alphanumeric characters
+// and of the given extra word characters, which must not include line
+// endings.
+class WordIndex {
+public:
+  static const size_t MAX_WORD_LENGTH = 80;
+
+  static bool supports_word_characters(const std::u16string &extra_word_characters);
+
+  // Scores how well `word` matches `query`, which it must contain as a
+  // subsequence, and fills in the indices of the matched characters. Matches
+  // at the start of subwords and runs of consecutive matches score higher.
+  static int32_t score_match(const std::u16string &word, const std::u16string &query,
+                             const std::u16string &lowercase_query, std::vector<uint32_t> *match_indices);
+
+  // An upper bound on the score of a word that contains `lowercase_query` as
+  // a subsequence, which is much cheaper to compute than the score itself.
+  static int32_t max_match_score(const std::u16string &word, const std::u16string &lowercase_query);
+
+  WordIndex(const std::u16string &extra_word_characters, const std::u16string &text);
+
+  const std::u16string &extra_word_characters() const;
+  uint32_t line_count() const;
+  size_t word_count() const;
+
+  // Replaces the rows from `start_row` through `start_row + deleted_row_count`
+  // with the lines of `inserted_text`.
+  void splice(uint32_t start_row, uint32_t deleted_row_count, const std::u16string &inserted_text);
+
+  // Adds the start positions of the words in rows `start_row` up to
+  // `end_row` that contain `lowercase_query` as a subsequence, in document
+  // order.
+  void find_words_with_subsequence(const std::u16string &lowercase_query, uint32_t start_row, uint32_t end_row,
+                                   std::unordered_map<std::u16string, std::vector<Point>> *result) const;
+
+private:
+  struct Occurrence {
+    uint32_t word_id;
+    uint32_t column;
+  };
+
+  using Line = std::vector<Occurrence>;
+
+  struct FoldedWord {
+    uint32_t start;
+    uint32_t length;
+  };
+
+  bool is_word_character(uint16_t c) const;
+  std::vector<Line> tokenize(const std::u16string &text);
+  uint32_t add_word(const char16_t *word, size_t length);
+  void remove_words(const Line &line);
+  void store_folded_word(uint32_t word_id);
+
+  std::u16string extra_word_characters_;
+  bool ascii_word_characters[128];
+  std::vector<Line> lines;
+  std::vector<std::u16string> words;
+  std::vector<uint64_t> signatures;
+  std::vector<FoldedWord> folded_words;
+  std::u16string folded_characters;
+  size_t unused_folded_character_count;
+  std::vector<uint32_t> occurrence_counts;
+  std::vector<uint32_t> free_word_ids;
+  std::unordered_map<std::u16string, uint32_t> word_ids;
+};
+
+// Keeps the `max_count` best of the matches added to it, ordered by descending
+// score and then by word. The worst of them is kept at the front of a heap, so
+// that words whose maximum score can't beat it don't need to be scored.
+template <typename Match>
+class TopMatches {
+public:
+  explicit TopMatches(size_t max_count) : max_count{max_count} {}
+
+  bool is_full() const {
+    return matches.size() >= max_count;
+  }
+
+  bool could_include(const std::u16string &word, int32_t max_score) const {
+    if (matches.size() < max_count) return true;
+    if (matches.empty()) return false;
+    const Match &worst_match = matches.front();
+    return max_score > worst_match.score || (max_score == worst_match.score && word < worst_match.word);
+  }
+
+  void add(Match &&match) {
+    if (matches.size() < max_count) {
+      matches.push_back(std::move(match));
+      std::push_heap(matches.begin(), matches.end(), is_better);
+    } else if (!matches.empty() && is_better(match, matches.front())) {
+      std::pop_heap(matches.begin(), matches.end(), is_better);
+      matches.back() = std::move(match);
+      std::push_heap(matches.begin(), matches.end(), is_better);
+    }
+  }
+
+  std::vector<Match> take() {
+    std::sort_heap(matches.begin(), matches.end(), is_better);
+    return std::move(matches);
+  }
+
+private:
+  static bool is_better(const Match &a, const Match &b) {
+    // Doing it this way helps us avoid sorting ambiguity keeping the ordering the same across platforms.
+    if (a.score > b.score) return true;
+    if (b.score > a.score) return false;
+    return a.word < b.word;
+  }
+
+  size_t max_count;
+  std::vector<Match> matches;
+};
+
+#endif // SUPERSTRING_WORD_INDEX_H_
@@ -0,0 +1,46 @@
+const {assert} = require('chai')
+
+const {TextBuffer, LiveSearch} = require('../..')
+
+describe('LiveSearch', function () {
+  if (!LiveSearch) return
+
+  it('keeps its matches up to date as the buffer changes', function () {
+    const buffer = new TextBuffer('abc abc\nxyz\nabc')
+    const search = new LiveSearch(buffer, /abc/)
+    assert.equal(search.getMatchCount(), 3)
+    assert.deepEqual(search.getMatches().map(match => match.id), [0, 1, 2])
+
+    buffer.setTextInRange({start: {row: 0, column: 1}, end: {row: 0, column: 1}}, '-')
+    let changes = search.splice({row: 0, column: 1}, {row: 0, column: 0}, {row: 0, column: 1})
+    assert.deepEqual(changes, {removed: [0], added: []})
+    assert.deepEqual(search.getMatches(), [
+      {id: 1, range: {start: {row: 0, column: 5}, end: {row: 0, column: 8}}},
+      {id: 2, range: {start: {row: 2, column: 0}, end: {row: 2, column: 3}}}
+    ])
+
+    buffer.setTextInRange({start: {row: 1, column: 0}, end: {row: 1, column: 3}}, 'ABC')
+    changes = search.splice({row: 1, column: 0}, {row: 0, column: 3}, {row: 0, column: 3})
+    assert.deepEqual(changes, {removed: [], added: []})
+
+    const ignoreCaseSearch = new LiveSearch(buffer, /abc/i)
+    assert.equal(ignoreCaseSearch.getMatchCount(), 3)
+  })
+
+  it('re-scans the given number of rows around each edit', function () {
+    const buffer = new TextBuffer('ab\ncd')
+    const search = new LiveSearch(buffer, /b\nc/, 1, 1)
+    assert.equal(search.getMatchCount(), 1)
+
+    buffer.setTextInRange({start: {row: 1, column: 2}, end: {row: 1, column: 2}}, '\nab')
+    const changes = search.splice({row: 1, column: 2}, {row: 0, column: 0}, {row: 1, column: 2})
+    assert.deepEqual(changes, {removed: [], added: []})
+    assert.deepEqual(search.getMatches().map(match => match.range), buffer.findAllSync(/b\nc/))
+  })
+
+  it('throws an error if the pattern is invalid', function () {
+    const buffer = new TextBuffer('abc')
+    assert.throws(() => new LiveSearch(buffer, /\k/), /\\k is not followed by/)
+    assert.throws(() => new LiveSearch(buffer, {source: 'a', flags: ''}), /must be a RegExp/)
+  })
+})
@@ -528,6 +528,260 @@ describe('MarkerIndex', () => {
     assert.equal(index.compare(4, 1), -1)
   })
 
+  it('can insert many markers at once', () => {
+    if (!MarkerIndex.prototype.insertMany) return
+
+    const random = new Random(42)
+    const batchIndex = new MarkerIndex(1)
+    const sequentialIndex = new MarkerIndex(1)
+
+    batchIndex.insert(1, {row: 0, column: 3}, {row: 2, column: 1})
+    sequentialIndex.insert(1, {row: 0, column: 3}, {row: 2, column: 1})
+
+    const ids = new Uint32Array(100)
+    const ranges = new Uint32Array(ids.length * 4)
+    for (let i = 0; i < ids.length; i++) {
+      const start = {row: random(10), column: random(10)}
+      const end = random(2) ? start : {row: start.row + 1 + random(2), column: random(10)}
+      ids[i] = i + 2
+      ranges.set([start.row, start.column, end.row, end.column], i * 4)
+      sequentialIndex.insert(ids[i], start, end)
+    }
+    batchIndex.insertMany(ids, ranges)
+
+    assert.deepEqual(batchIndex.dump(), sequentialIndex.dump())
+    for (let row = 0; row < 12; row++) {
+      const start = {row, column: 5}
+      const end = {row: row + 1, column: 2}
+      assert.deepEqual(batchIndex.findIntersecting(start, end), sequentialIndex.findIntersecting(start, end))
+      assert.deepEqual(batchIndex.findContainedIn(start, end), sequentialIndex.findContainedIn(start, end))
+    }
+
+    batchIndex.splice({row: 3, column: 2}, {row: 1, column: 0}, {row: 0, column: 4})
+    sequentialIndex.splice({row: 3, column: 2}, {row: 1, column: 0}, {row: 0, column: 4})
+    batchIndex.remove(50)
+    sequentialIndex.remove(50)
+    assert.deepEqual(batchIndex.dump(), sequentialIndex.dump())
+
+    assert.throws(() => batchIndex.insertMany(new Uint32Array([200]), new Uint32Array([0, 0])))
+    assert.throws(() => batchIndex.insertMany(new Uint32Array([200, 1]), new Uint32Array(8)), /already in the index/)
+    assert.throws(() => batchIndex.insertMany(new Uint32Array([200, 200]), new Uint32Array(8)), /must be unique/)
+    assert(!batchIndex.has(200))
+  })
+
+  it('can apply many splices at once', () => {
+    if (!MarkerIndex.prototype.spliceMany) return
+
+    const random = new Random(42)
+    const batchIndex = new MarkerIndex(1)
+    const sequentialIndex = new MarkerIndex(1)
+
+    for (let id = 0; id < 100; id++) {
+      const start = {row: random(20), column: random(10)}
+      const end = random(2) ? start : {row: start.row + random(3), column: random(10)}
+      batchIndex.insert(id, start, end)
+      sequentialIndex.insert(id, start, end)
+      if (random(4) === 0) {
+        batchIndex.setExclusive(id, true)
+        sequentialIndex.setExclusive(id, true)
+      }
+    }
+
+    // One splice per row, as if typing or deleting with a cursor on each line
+    const splices = new Uint32Array(20 * 6)
+    const expectedInvalidated = {touch: new Set(), inside: new Set(), overlap: new Set(), surround: new Set()}
+    for (let row = 19; row >= 0; row--) {
+      const start = {row, column: random(10)}
+      const oldExtent = {row: 0, column: random(3)}
+      const newExtent = {row: 0, column: random(3)}
+      splices.set([start.row, start.column, oldExtent.row, oldExtent.column, newExtent.row, newExtent.column], row * 6)
+
+      const invalidated = sequentialIndex.splice(start, oldExtent, newExtent)
+      for (const key in expectedInvalidated) {
+        for (const id of invalidated[key]) expectedInvalidated[key].add(id)
+      }
+    }
+
+    assert.deepEqual(batchIndex.spliceMany(splices), expectedInvalidated)
+    assert.deepEqual(batchIndex.dump(), sequentialIndex.dump())
+
+    assert.throws(() => batchIndex.spliceMany(new Uint32Array([0, 0, 0, 0, 0])))
+    assert.throws(() => batchIndex.spliceMany(new Uint32Array([0, 5, 0, 0, 0, 1, 0, 2, 0, 0, 0, 1])))
+  })
+
+  it('can return query results as typed arrays', () => {
+    if (!MarkerIndex.prototype.findIntersectingPacked) return
+
+    const random = new Random(42)
+    const markerIndex = new MarkerIndex(1)
+    for (let id = 0; id < 100; id++) {
+      const start = {row: random(20), column: random(10)}
+      const end = {row: start.row + random(3), column: random(10)}
+      markerIndex.insert(id, start, compare(start, end) < 0 ? end : start)
+    }
+
+    const sorted = (set) => Uint32Array.from(set).sort()
+    for (let row = 0; row < 20; row++) {
+      const start = {row, column: 5}
+      const end = {row: row + 2, column: 0}
+      assert.deepEqual(markerIndex.findIntersectingPacked(start, end), sorted(markerIndex.findIntersecting(start, end)))
+      assert.deepEqual(markerIndex.findContainedInPacked(start, end), sorted(markerIndex.findContainedIn(start, end)))
+      assert.deepEqual(markerIndex.findStartingInPacked(start, end), sorted(markerIndex.findStartingIn(start, end)))
+    }
+
+    const dump = markerIndex.dump()
+    const {ids, ranges} = markerIndex.dumpPacked()
+    assert.equal(ids.length, 100)
+    assert.equal(ranges.length, 400)
+    for (let i = 0; i < ids.length; i++) {
+      const {start, end} = dump[ids[i]]
+      assert.deepEqual(Array.from(ranges.subarray(i * 4, i * 4 + 4)), [start.row, start.column, end.row, end.column])
+    }
+
+    const invalidated = markerIndex.splicePacked({row: 3, column: 2}, {row: 2, column: 0}, {row: 0, column: 1})
+    assert(invalidated.touch instanceof Uint32Array)
+    for (const id of invalidated.inside) assert(invalidated.touch.includes(id))
+    assert.deepEqual(Array.from(invalidated.touch), Array.from(invalidated.touch).sort((a, b) => a - b))
+  })
+
+  it('can filter queries by marker layer', () => {
+    if (!MarkerIndex.prototype.setLayer) return
+
+    const markerIndex = new MarkerIndex()
+    for (let id = 0; id < 10; id++) {
+      markerIndex.insert(id, {row: 0, column: id}, {row: 0, column: id + 5})
+    }
+    markerIndex.setLayer(2, 1)
+    markerIndex.setLayer(3, 1)
+    markerIndex.setLayer(4, 3)
+    assert.equal(markerIndex.getLayer(3), 1)
+    assert.equal(markerIndex.getLayer(5), 0)
+
+    const start = {row: 0, column: 3}
+    const end = {row: 0, column: 6}
+    assert.deepEqual(markerIndex.findIntersecting(start, end), new Set([0, 1, 2, 3, 4, 5, 6]))
+    assert.deepEqual(markerIndex.findIntersecting(start, end, 0b1), new Set([0, 1, 5, 6]))
+    assert.deepEqual(markerIndex.findIntersecting(start, end, 0b10), new Set([2, 3]))
+    assert.deepEqual(markerIndex.findIntersecting(start, end, 0b1010), new Set([2, 3, 4]))
+    assert.deepEqual(markerIndex.findStartingAt({row: 0, column: 4}, 0b1000), new Set([4]))
+
+    const invalidated = markerIndex.splice({row: 0, column: 4}, {row: 0, column: 1}, {row: 0, column: 0})
+    assert(invalidated.surround.has(2))
+    assert.deepEqual(markerIndex.findEndingIn({row: 0, column: 5}, {row: 0, column: 6}, 0b10), new Set([2]))
+
+    markerIndex.remove(2)
+    markerIndex.insert(2, {row: 0, column: 0}, {row: 0, column: 1})
+    assert.equal(markerIndex.getLayer(2), 0)
+    assert.throws(() => markerIndex.setLayer(1, 32))
+
+    markerIndex.setLayer(20, 1)
+    assert.equal(markerIndex.getLayer(20), 0)
+    markerIndex.insert(20, {row: 0, column: 0}, {row: 0, column: 1})
+    assert.deepEqual(markerIndex.findStartingAt({row: 0, column: 0}, 0b10), new Set())
+  })
+
+  it('can find the nearest markers before and after a position', () => {
+    if (!MarkerIndex.prototype.findNextStartingAfter) return
+
+    const markerIndex = new MarkerIndex()
+    markerIndex.insert(1, {row: 0, column: 2}, {row: 0, column: 4})
+    markerIndex.insert(2, {row: 1, column: 0}, {row: 1, column: 3})
+    markerIndex.insert(3, {row: 1, column: 0}, {row: 2, column: 0})
+    markerIndex.insert(4, {row: 3, column: 5}, {row: 3, column: 5})
+    markerIndex.insert(5, {row: 4, column: 0}, {row: 4, column: 1})
+    markerIndex.setLayer(3, 1)
+
+    assert.deepEqual(markerIndex.findNextStartingAfter({row: 0, column: 2}, 10), [2, 3, 4, 5])
+    assert.deepEqual(markerIndex.findNextStartingAfter({row: 0, column: 0}, 2), [1, 2])
+    assert.deepEqual(markerIndex.findNextStartingAfter({row: 0, column: 3}, 2, 0b1), [2, 4])
+    assert.deepEqual(markerIndex.findNextStartingAfter({row: 4, column: 0}, 2), [])
+
+    assert.deepEqual(markerIndex.findPreviousEndingBefore({row: 3, column: 6}, 10), [4, 3, 2, 1])
+    assert.deepEqual(markerIndex.findPreviousEndingBefore({row: 3, column: 5}, 1), [3])
+    assert.deepEqual(markerIndex.findPreviousEndingBefore({row: 3, column: 5}, 1, 0b1), [2])
+    assert.deepEqual(markerIndex.findPreviousEndingBefore({row: 0, column: 4}, 5), [])
+
+    markerIndex.splice({row: 0, column: 0}, {row: 0, column: 0}, {row: 2, column: 0})
+    assert.deepEqual(markerIndex.findNextStartingAfter({row: 2, column: 2}, 1), [2])
+    assert.deepEqual(markerIndex.findNextStartingAfter({row: 2, column: 0}, 1), [1])
+  })
+
+  it('can walk boundaries in batches with a cursor', () => {
+    if (!MarkerIndex.prototype.createBoundaryCursor) return
+
+    const random = new Random(42)
+    const markerIndex = new MarkerIndex(1)
+    for (let id = 0; id < 100; id++) {
+      const start = {row: random(20), column: random(10)}
+      const end = {row: start.row + random(3), column: random(10)}
+      markerIndex.insert(id, start, compare(start, end) < 0 ? end : start)
+    }
+
+    const start = {row: 5, column: 0}
+    const expected = markerIndex.findBoundariesAfter(start, 1000)
+    const cursor = markerIndex.createBoundaryCursor()
+    assert.deepEqual(Array.from(cursor.seek(start)), expected.containingStart)
+
+    const boundaries = []
+    while (true) {
+      const {positions, idCounts, ids} = cursor.next(random.intBetween(1, 7))
+      if (positions.length === 0) break
+      let offset = 0
+      for (let i = 0; i < positions.length / 2; i++) {
+        const startingCount = idCounts[i * 2]
+        const endingCount = idCounts[i * 2 + 1]
+        boundaries.push({
+          position: {row: positions[i * 2], column: positions[i * 2 + 1]},
+          starting: new Set(ids.subarray(offset, offset + startingCount)),
+          ending: new Set(ids.subarray(offset + startingCount, offset + startingCount + endingCount))
+        })
+        offset += startingCount + endingCount
+      }
+    }
+    assert.deepEqual(boundaries, expected.boundaries)
+
+    // After a change, the cursor picks up after the last boundary it returned
+    cursor.seek(start)
+    const {positions} = cursor.next(3)
+    const lastPosition = {row: positions[4], column: positions[5]}
+    markerIndex.insert(100, {row: 0, column: 0}, {row: 0, column: 1})
+    const nextBoundaries = markerIndex.findBoundariesAfter(lastPosition, 3).boundaries
+    const next = cursor.next(2)
+    assert.deepEqual(
+      {row: next.positions[0], column: next.positions[1]},
+      nextBoundaries.find(boundary => compare(boundary.position, lastPosition) > 0).position
+    )
+  })
+
+  it('reports up-to-date ranges while edits move through the document', () => {
+    const random = new Random(42)
+    const markerIndex = new MarkerIndex(1)
+    const ranges = []
+    for (let id = 0; id < 100; id++) {
+      const start = {row: random(100), column: 0}
+      const end = {row: start.row, column: 1}
+      markerIndex.insert(id, start, end)
+      ranges.push({start, end})
+    }
+
+    for (let row = 0; row < 80; row++) {
+      markerIndex.splice({row, column: 0}, {row: 0, column: 0}, {row: 0, column: 1})
+      for (const range of ranges) {
+        if (range.start.row === row) range.start = traverse(range.start, {row: 0, column: 1})
+        if (range.end.row === row) range.end = traverse(range.end, {row: 0, column: 1})
+      }
+
+      for (let i = 0; i < 5; i++) {
+        const id = random(ranges.length)
+        assert.deepEqual(markerIndex.getRange(id), ranges[id])
+      }
+    }
+
+    for (let id = 0; id < ranges.length; id++) {
+      assert.deepEqual(markerIndex.getRange(id), ranges[id])
+    }
+  })
+
   it('handles range queries involving Infinity', () => {
     let index = new MarkerIndex()
     index.insert(1, {row: 10, column: 10}, {row: 20, column: 20})
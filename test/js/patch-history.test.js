@@ -0,0 +1,62 @@
+const {assert} = require('chai')
+
+const {Patch, PatchHistory} = require('../..')
+
+describe('PatchHistory', function () {
+  if (!PatchHistory) return
+
+  it('composes the changes between any two checkpoints', function () {
+    const history = new PatchHistory()
+
+    const patch1 = new Patch()
+    patch1.splice({row: 0, column: 1}, {row: 0, column: 1}, {row: 0, column: 2}, 'b', 'BB')
+    assert.equal(history.push(patch1), 1)
+
+    const patch2 = new Patch()
+    patch2.splice({row: 0, column: 0}, {row: 0, column: 0}, {row: 1, column: 0}, '', 'x\n')
+    assert.equal(history.push(patch2), 2)
+    assert.equal(history.getCheckpoint(), 2)
+
+    assert.deepEqual(JSON.parse(JSON.stringify(history.compose(0, 2).getChanges())), [
+      {
+        oldStart: {row: 0, column: 0},
+        oldEnd: {row: 0, column: 0},
+        newStart: {row: 0, column: 0},
+        newEnd: {row: 1, column: 0},
+        oldText: '',
+        newText: 'x\n'
+      },
+      {
+        oldStart: {row: 0, column: 1},
+        oldEnd: {row: 0, column: 2},
+        newStart: {row: 1, column: 1},
+        newEnd: {row: 1, column: 3},
+        oldText: 'b',
+        newText: 'BB'
+      }
+    ])
+
+    assert.deepEqual(JSON.parse(JSON.stringify(history.compose(2, 0).getChanges())), [
+      {
+        oldStart: {row: 0, column: 0},
+        oldEnd: {row: 1, column: 0},
+        newStart: {row: 0, column: 0},
+        newEnd: {row: 0, column: 0},
+        oldText: 'x\n',
+        newText: ''
+      },
+      {
+        oldStart: {row: 1, column: 1},
+        oldEnd: {row: 1, column: 3},
+        newStart: {row: 0, column: 1},
+        newEnd: {row: 0, column: 2},
+        oldText: 'BB',
+        newText: 'b'
+      }
+    ])
+
+    history.truncate(1)
+    assert.equal(history.getCheckpoint(), 1)
+    assert.throws(() => history.compose(0, 2), 'Invalid checkpoint')
+  })
+})
@@ -177,6 +177,25 @@ describe('Patch', function () {
     assert.deepEqual(patch2.copy().getChanges(), patch2.getChanges())
   })
 
+  it('can translate many positions at once', function () {
+    if (!Patch.prototype.translateOldToNew) return
+
+    const patch = new Patch()
+    patch.splice({row: 0, column: 3}, {row: 0, column: 4}, {row: 0, column: 5})
+    patch.splice({row: 1, column: 0}, {row: 0, column: 0}, {row: 1, column: 0})
+
+    assert.deepEqual(
+      Array.from(patch.translateOldToNew(new Uint32Array([0, 7, 0, 1, 0, 5, 1, 2]))),
+      [0, 8, 0, 1, 0, 8, 2, 2]
+    )
+    assert.deepEqual(
+      Array.from(patch.translateNewToOld(new Uint32Array([0, 3, 0, 10, 2, 2]))),
+      [0, 3, 0, 9, 1, 2]
+    )
+    assert.throws(() => patch.translateOldToNew([0, 1]), TypeError)
+    assert.throws(() => patch.translateOldToNew(new Uint32Array([0, 1, 2])), TypeError)
+  })
+
   it('can serialize/deserialize patches', () => {
     const emptyPatch = Patch.deserialize(new Patch().serialize())
     assert.equal(emptyPatch.getChangeCount(), 0)
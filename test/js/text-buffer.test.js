@@ -914,6 +914,38 @@ describe('TextBuffer', () => {
     })
   })
 
+  describe('.serializeChangesToFile and .deserializeChangesFromFile', () => {
+    if (!TextBuffer.prototype.serializeChangesToFile) return
+
+    it('streams the outstanding changes to a file and restores them', async () => {
+      const {path: filePath} = temp.openSync()
+      const buffer = new TextBuffer('abc')
+      buffer.setTextInRange(Range(Point(0, 0), Point(0, 0)), '\n')
+      buffer.setTextInRange(Range(Point(1, 3), Point(1, 3)), 'D'.repeat(100000))
+
+      const snapshot = buffer.getSnapshot()
+      buffer.setTextInRange(Range(Point(0, 0), Point(0, 0)), 'E')
+      await buffer.serializeChangesToFile(filePath)
+      snapshot.destroy()
+
+      const buffer2 = new TextBuffer('123')
+      assert.equal(buffer2.deserializeChangesFromFile(filePath), true)
+      assert.equal(buffer2.getText(), 'E\n123' + 'D'.repeat(100000))
+      assert.equal(buffer2.deserializeChangesFromFile(filePath), false)
+    })
+
+    it('rejects with an error if the file cannot be written', async () => {
+      const buffer = new TextBuffer('abc')
+      let error
+      try {
+        await buffer.serializeChangesToFile(path.join(temp.mkdirSync(), 'nonexistent', 'changes'))
+      } catch (e) {
+        error = e
+      }
+      assert.equal(error.code, 'ENOENT')
+    })
+  })
+
   describe('.find (sync and async)', () => {
     it('returns the range of the first match with the given pattern', async () => {
       const buffer = new TextBuffer('abc\ndef')
@@ -1237,6 +1269,113 @@ describe('TextBuffer', () => {
     })
   })
 
+  describe('.findAllInBatches', () => {
+    it('reports all the matches in batches, resolving with the number of matches', async () => {
+      const buffer = new TextBuffer('ab\n'.repeat(25000))
+      const expectedRanges = buffer.findAllSync(/b/)
+
+      const batches = []
+      const matchCount = await buffer.findAllInBatches(/b/, batch => { batches.push(batch) })
+      assert.equal(matchCount, 25000)
+      assert(batches.length > 2)
+      assert.deepEqual([].concat(...batches), expectedRanges)
+    })
+
+    it('stops after the given maximum number of matches, within the given range', async () => {
+      const buffer = new TextBuffer('abc\nabc\nabc\nabc')
+      const batches = []
+      const matchCount = await buffer.findAllInBatches(/\w/, {range: Range(Point(1, 1), Point(3, 0)), maxCount: 4}, batch => {
+        batches.push(batch)
+      })
+      assert.equal(matchCount, 4)
+      assert.deepEqual(batches, [[
+        Range(Point(1, 1), Point(1, 2)),
+        Range(Point(1, 2), Point(1, 3)),
+        Range(Point(2, 0), Point(2, 1)),
+        Range(Point(2, 1), Point(2, 2))
+      ]])
+    })
+
+    it('reports the matches in the rows of the priority range first', async () => {
+      const buffer = new TextBuffer('ab\ncd\nef\ngh')
+      const batches = []
+      const matchCount = await buffer.findAllInBatches(/\w/, {priorityRange: Range(Point(1, 1), Point(2, 0))}, batch => {
+        batches.push(batch)
+      })
+      assert.equal(matchCount, 8)
+      assert.deepEqual(batches[0], [
+        Range(Point(1, 0), Point(1, 1)),
+        Range(Point(1, 1), Point(1, 2)),
+        Range(Point(2, 0), Point(2, 1)),
+        Range(Point(2, 1), Point(2, 2))
+      ])
+      assert.deepEqual([].concat(...batches.slice(1)), [
+        Range(Point(3, 0), Point(3, 1)),
+        Range(Point(3, 1), Point(3, 2)),
+        Range(Point(0, 0), Point(0, 1)),
+        Range(Point(0, 1), Point(0, 2))
+      ])
+    })
+
+    it('stops searching when the batch callback returns false', async () => {
+      const buffer = new TextBuffer('ab\n'.repeat(25000))
+      let batchCount = 0
+      const matchCount = await buffer.findAllInBatches(/b/, batch => {
+        batchCount++
+        return false
+      })
+      assert.equal(batchCount, 1)
+      assert(matchCount < 25000)
+    })
+  })
+
+  describe('.findAllMulti (sync and async)', () => {
+    it('returns the matches of all the given patterns along with the index of the pattern they matched', async () => {
+      const buffer = new TextBuffer('// TODO: fix\nlet x = 1 // fixme\n')
+      buffer.setTextInRange(Range(Point(1, 3), Point(1, 3)), ' y')
+
+      const expectedMatches = [
+        {patternIndex: 0, range: Range(Point(0, 3), Point(0, 7))},
+        {patternIndex: 1, range: Range(Point(1, 4), Point(1, 5))},
+        {patternIndex: 2, range: Range(Point(1, 15), Point(1, 20))}
+      ]
+      assert.deepEqual(buffer.findAllMultiSync(['TODO', /\by\b/, /FIXME/i]), expectedMatches)
+      assert.deepEqual(await buffer.findAllMulti(['TODO', /\by\b/, /FIXME/i]), expectedMatches)
+    })
+
+    it('prefers the earlier pattern when several match at the same position', () => {
+      const buffer = new TextBuffer('abcd')
+      assert.deepEqual(buffer.findAllMultiSync([/b\w/, 'bcd']), [
+        {patternIndex: 0, range: Range(Point(0, 1), Point(0, 3))}
+      ])
+      assert.deepEqual(buffer.findAllMultiSync(['bcd', /b\w/]), [
+        {patternIndex: 0, range: Range(Point(0, 1), Point(0, 4))}
+      ])
+    })
+
+    it('searches for strings literally', () => {
+      const buffer = new TextBuffer('a.b axb')
+      assert.deepEqual(buffer.findAllMultiSync(['a.b']), [
+        {patternIndex: 0, range: Range(Point(0, 0), Point(0, 3))}
+      ])
+    })
+
+    it('restricts the search to the given range', async () => {
+      const buffer = new TextBuffer('abc\nabc\nabc')
+      const expectedMatches = [
+        {patternIndex: 1, range: Range(Point(1, 0), Point(1, 1))},
+        {patternIndex: 0, range: Range(Point(1, 1), Point(1, 3))}
+      ]
+      assert.deepEqual(buffer.findAllMultiInRangeSync(['bc', /a/], Range(Point(0, 3), Point(1, 3))), expectedMatches)
+      assert.deepEqual(await buffer.findAllMultiInRange(['bc', /a/], Range(Point(0, 3), Point(1, 3))), expectedMatches)
+    })
+
+    it('throws an error if any of the patterns is invalid', () => {
+      const buffer = new TextBuffer('abc')
+      assert.throws(() => buffer.findAllMultiSync(['a', /\k/]), /\\k is not followed by/)
+    })
+  })
+
   describe('.findAndMarkAllSync', () => {
     it('stores all of the matching ranges in the given marker index', () => {
       const markerIndex = new MarkerIndex()
@@ -0,0 +1,33 @@
+const {assert} = require('chai')
+
+const {TextBuffer, WordCorpus} = require('../..')
+
+describe('WordCorpus', function () {
+  if (!WordCorpus) return
+
+  it('finds the best matching words across all of its buffers', async function () {
+    const buffer1 = new TextBuffer('banana band\nbandana')
+    const buffer2 = new TextBuffer('bonanza\nbanana')
+    const corpus = new WordCorpus()
+    corpus.addBuffer(buffer1)
+    corpus.addBuffer(buffer2)
+    corpus.addBuffer(buffer1)
+    assert.equal(corpus.getBufferCount(), 2)
+
+    const matches = await corpus.findWordsWithSubsequence('bna', '', 2)
+    assert.deepEqual(matches.map(match => match.word), ['banana', 'bonanza'])
+    assert.deepEqual(matches[0].matchIndices, [0, 2, 3])
+    assert.equal(matches[0].score, 12)
+    assert.equal(matches[0].positions.length, 2)
+    assert.equal(matches[0].positions[0].buffer, buffer1)
+    assert.deepEqual(matches[0].positions[0].positions, [{row: 0, column: 0}])
+    assert.equal(matches[0].positions[1].buffer, buffer2)
+    assert.deepEqual(matches[0].positions[1].positions, [{row: 1, column: 0}])
+
+    assert.isTrue(corpus.removeBuffer(buffer1))
+    assert.isFalse(corpus.removeBuffer(buffer1))
+    const remainingMatches = await corpus.findWordsWithSubsequence('bna', '', 10)
+    assert.deepEqual(remainingMatches.map(match => match.word), ['banana', 'bonanza'])
+    assert.equal(remainingMatches[0].positions[0].buffer, buffer2)
+  })
+})
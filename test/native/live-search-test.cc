@@ -0,0 +1,101 @@
+#include "test-helpers.h"
+#include "live-search.h"
+
+using std::u16string;
+using std::vector;
+using Match = LiveSearch::Match;
+
+static vector<Range> match_ranges(const LiveSearch &search) {
+  vector<Range> result;
+  for (const Match &match : search.matches()) result.push_back(match.range);
+  return result;
+}
+
+TEST_CASE("LiveSearch::splice - reporting changed matches") {
+  TextBuffer buffer{u"abc abc\nxyz\nabc xyz abc"};
+  u16string error_message;
+  LiveSearch search(buffer, Regex(u"abc", &error_message));
+  REQUIRE(search.matches() == vector<Match>({
+    {0, Range{Point{0, 0}, Point{0, 3}}},
+    {1, Range{Point{0, 4}, Point{0, 7}}},
+    {2, Range{Point{2, 0}, Point{2, 3}}},
+    {3, Range{Point{2, 8}, Point{2, 11}}},
+  }));
+
+  // Breaking a match removes it, and the matches after the edit keep their
+  // ids as they shift.
+  buffer.set_text_in_range(Range{Point{0, 1}, Point{0, 1}}, u"-");
+  LiveSearch::Changes changes = search.splice(Point{0, 1}, Point{0, 0}, Point{0, 1});
+  REQUIRE(changes.removed == vector<LiveSearch::MatchId>({0}));
+  REQUIRE(changes.added == vector<Match>());
+  REQUIRE(search.matches() == vector<Match>({
+    {1, Range{Point{0, 5}, Point{0, 8}}},
+    {2, Range{Point{2, 0}, Point{2, 3}}},
+    {3, Range{Point{2, 8}, Point{2, 11}}},
+  }));
+
+  // Inserting lines adds matches, and the matches on the edited row that are
+  // found again aren't reported.
+  buffer.set_text_in_range(Range{Point{1, 3}, Point{1, 3}}, u" abc\nabc");
+  changes = search.splice(Point{1, 3}, Point{0, 0}, Point{1, 3});
+  REQUIRE(changes.removed == vector<LiveSearch::MatchId>());
+  REQUIRE(changes.added == vector<Match>({
+    {4, Range{Point{1, 4}, Point{1, 7}}},
+    {5, Range{Point{2, 0}, Point{2, 3}}},
+  }));
+  REQUIRE(search.match_count() == 5);
+  REQUIRE(match_ranges(search) == buffer.find_all(Regex(u"abc", &error_message)));
+}
+
+TEST_CASE("LiveSearch::splice - matches that span rows") {
+  TextBuffer buffer{u"ab\ncd\nab\ncd"};
+  u16string error_message;
+  LiveSearch search(buffer, Regex(u"b\\nc", &error_message), 1, 1);
+  REQUIRE(match_ranges(search) == vector<Range>({
+    Range{Point{0, 1}, Point{1, 1}},
+    Range{Point{2, 1}, Point{3, 1}},
+  }));
+
+  // An edit on the row after a match can break it.
+  buffer.set_text_in_range(Range{Point{3, 0}, Point{3, 0}}, u"x");
+  LiveSearch::Changes changes = search.splice(Point{3, 0}, Point{0, 0}, Point{0, 1});
+  REQUIRE(changes.removed == vector<LiveSearch::MatchId>({1}));
+  REQUIRE(changes.added == vector<Match>());
+
+  // So can an edit on the row before it.
+  buffer.set_text_in_range(Range{Point{0, 2}, Point{0, 2}}, u"x");
+  changes = search.splice(Point{0, 2}, Point{0, 0}, Point{0, 1});
+  REQUIRE(changes.removed == vector<LiveSearch::MatchId>({0}));
+  REQUIRE(search.match_count() == 0);
+}
+
+TEST_CASE("LiveSearch::splice - random edits") {
+  const char16_t *patterns[] = {u"a+b?", u"b.", u"^a*", u"b$", u"(?<=a)b", u"", u"[ab]\\n", u"a\\nb"};
+  const uint32_t context_rows[] = {0, 0, 0, 0, 0, 0, 1, 1};
+
+  auto t = time(nullptr);
+  for (uint32_t i = 0; i < 200; i++) {
+    uint32_t seed = t * 1000 + i;
+    Generator rand(seed);
+    cout << "seed: " << seed << "\n";
+
+    uint32_t pattern_index = rand() % 8;
+    u16string error_message;
+    Regex regex(patterns[pattern_index], &error_message);
+    TextBuffer buffer{get_random_string(rand, 40)};
+    LiveSearch search(buffer, Regex(patterns[pattern_index], &error_message),
+                      context_rows[pattern_index], context_rows[pattern_index]);
+
+    for (uint32_t j = 0; j < 10; j++) {
+      size_t previous_count = search.match_count();
+      Range deleted_range = get_random_range(rand, buffer);
+      u16string inserted_text = get_random_string(rand, 5);
+      Point inserted_extent = Text(inserted_text).extent();
+      buffer.set_text_in_range(deleted_range, move(inserted_text));
+
+      LiveSearch::Changes changes = search.splice(deleted_range.start, deleted_range.extent(), inserted_extent);
+      REQUIRE(search.match_count() == previous_count - changes.removed.size() + changes.added.size());
+      REQUIRE(match_ranges(search) == buffer.find_all(regex));
+    }
+  }
+}
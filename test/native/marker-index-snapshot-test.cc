@@ -0,0 +1,64 @@
+#include "test-helpers.h"
+#include "marker-index.h"
+#include <random>
+
+using std::uniform_int_distribution;
+using std::default_random_engine;
+using std::vector;
+using MarkerId = MarkerIndex::MarkerId;
+
+static vector<MarkerId> to_vector(const MarkerIndex::MarkerIdSet &ids) {
+  return vector<MarkerId>(ids.begin(), ids.end());
+}
+
+TEST_CASE("MarkerIndex::Snapshot - querying a copy of the index") {
+  MarkerIndex marker_index;
+  marker_index.insert(1, Point(0, 2), Point(0, 5));
+  marker_index.insert(2, Point(0, 4), Point(1, 0));
+  marker_index.insert(3, Point(1, 0), Point(1, 0));
+
+  MarkerIndex::Snapshot snapshot = marker_index.create_snapshot();
+  marker_index.splice(Point(0, 0), Point(0, 0), Point(2, 0));
+  marker_index.remove(2);
+
+  REQUIRE(snapshot.size() == 3);
+  REQUIRE(snapshot.has(2));
+  REQUIRE(!snapshot.has(4));
+  REQUIRE(snapshot.get_range(1) == (Range{Point(0, 2), Point(0, 5)}));
+  REQUIRE(snapshot.get_end(2) == Point(1, 0));
+  REQUIRE(marker_index.get_start(1) == Point(2, 2));
+
+  REQUIRE(to_vector(snapshot.find_intersecting(Point(0, 5), Point(0, 6))) == vector<MarkerId>({1, 2}));
+  REQUIRE(to_vector(snapshot.find_containing(Point(0, 4), Point(0, 5))) == vector<MarkerId>({1, 2}));
+  REQUIRE(to_vector(snapshot.find_contained_in(Point(0, 3), Point(1, 0))) == vector<MarkerId>({2, 3}));
+  REQUIRE(to_vector(snapshot.find_starting_in(Point(0, 3), Point(1, 0))) == vector<MarkerId>({2, 3}));
+  REQUIRE(to_vector(snapshot.find_ending_in(Point(0, 0), Point(0, 5))) == vector<MarkerId>({1}));
+}
+
+TEST_CASE("MarkerIndex::Snapshot - random queries") {
+  for (unsigned seed = 0; seed < 50; seed++) {
+    default_random_engine rand(seed);
+    uniform_int_distribution<unsigned> row(0, 20), column(0, 10), small(0, 3);
+
+    MarkerIndex marker_index(seed);
+    for (MarkerId id = 0; id < 200; id++) {
+      Point start(row(rand), column(rand));
+      Point end = small(rand) == 0 ? start : start.traverse(Point(small(rand), column(rand)));
+      marker_index.insert(id, start, end);
+    }
+    marker_index.splice(Point(row(rand), column(rand)), Point(small(rand), column(rand)), Point(0, column(rand)));
+
+    MarkerIndex::Snapshot snapshot = marker_index.create_snapshot();
+    REQUIRE(snapshot.dump() == marker_index.dump());
+
+    for (int i = 0; i < 50; i++) {
+      Point start(row(rand), column(rand));
+      Point end = start.traverse(Point(small(rand), column(rand)));
+      REQUIRE(snapshot.find_intersecting(start, end) == marker_index.find_intersecting(start, end));
+      REQUIRE(snapshot.find_containing(start, end) == marker_index.find_containing(start, end));
+      REQUIRE(snapshot.find_contained_in(start, end) == marker_index.find_contained_in(start, end));
+      REQUIRE(snapshot.find_starting_in(start, end) == marker_index.find_starting_in(start, end));
+      REQUIRE(snapshot.find_ending_in(start, end) == marker_index.find_ending_in(start, end));
+    }
+  }
+}
@@ -0,0 +1,31 @@
+#include "test-helpers.h"
+#include "marker-index.h"
+
+using std::vector;
+using MarkerId = MarkerIndex::MarkerId;
+
+static vector<MarkerId> to_vector(const MarkerIndex::MarkerIdSet &ids) {
+  return vector<MarkerId>(ids.begin(), ids.end());
+}
+
+TEST_CASE("MarkerIndex::set_layer - removing and reinserting a marker") {
+  MarkerIndex marker_index;
+  marker_index.insert(1, Point(0, 0), Point(0, 2));
+  marker_index.insert(2, Point(0, 1), Point(0, 3));
+  marker_index.set_layer(2, 3);
+  REQUIRE(marker_index.get_layer(2) == 3);
+
+  // A removed marker leaves its layer, so the same id starts out in layer 0
+  // when it's inserted again.
+  marker_index.remove(2);
+  REQUIRE(marker_index.get_layer(2) == 0);
+  marker_index.insert(2, Point(0, 1), Point(0, 3));
+  REQUIRE(marker_index.get_layer(2) == 0);
+  REQUIRE(to_vector(marker_index.filter_by_layers(marker_index.find_intersecting(Point(0, 1), Point(0, 1)), 0b1)) ==
+          vector<MarkerId>({1, 2}));
+
+  // Ids that aren't in the index can't be given a layer.
+  marker_index.set_layer(3, 1);
+  marker_index.insert(3, Point(0, 0), Point(0, 0));
+  REQUIRE(marker_index.get_layer(3) == 0);
+}
@@ -0,0 +1,106 @@
+#include "test-helpers.h"
+#include "patch-history.h"
+#include "text-slice.h"
+#include <algorithm>
+
+using std::move;
+using std::u16string;
+using std::vector;
+
+// Positions inside a CRLF are ambiguous, and transactions that join a CR and
+// an LF from separate changes don't compose the same way in every grouping.
+static u16string get_random_string_without_cr(Generator &rand, uint32_t character_count) {
+  u16string result = get_random_string(rand, character_count);
+  result.erase(std::remove(result.begin(), result.end(), '\r'), result.end());
+  return result;
+}
+
+static Text apply_patch(Text text, const Patch &patch) {
+  for (const Patch::Change &change : patch.get_changes()) {
+    text.splice(change.new_start, change.old_end.traversal(change.old_start), *change.new_text);
+  }
+  return text;
+}
+
+TEST_CASE("PatchHistory::compose - basic") {
+  PatchHistory history;
+
+  Patch patch1;
+  patch1.splice(Point{0, 1}, Point{0, 1}, Point{0, 2}, Text{u"b"}, Text{u"BB"});
+  REQUIRE(history.push(move(patch1)));
+
+  Patch patch2;
+  patch2.splice(Point{0, 0}, Point{0, 0}, Point{1, 0}, Text{u""}, Text{u"x\n"});
+  REQUIRE(history.push(move(patch2)));
+
+  Patch patch3;
+  patch3.splice(Point{1, 3}, Point{0, 1}, Point{0, 0}, Text{u"c"}, Text{u""});
+  REQUIRE(history.push(move(patch3)));
+
+  REQUIRE(history.size() == 3);
+  REQUIRE(history.cached_patch_count() == 1);
+
+  Text text_0{u"abc"};
+  REQUIRE(apply_patch(text_0, *history.compose(0, 3)) == Text{u"x\naBB"});
+  REQUIRE(apply_patch(text_0, *history.compose(0, 1)) == Text{u"aBBc"});
+  REQUIRE(apply_patch(Text{u"aBBc"}, *history.compose(1, 3)) == Text{u"x\naBB"});
+  REQUIRE(apply_patch(Text{u"x\naBB"}, *history.compose(3, 0)) == text_0);
+  REQUIRE(history.compose(2, 2)->get_change_count() == 0);
+  REQUIRE(!history.compose(0, 4));
+
+  history.truncate(1);
+  REQUIRE(history.size() == 1);
+  REQUIRE(history.cached_patch_count() == 0);
+  REQUIRE(apply_patch(text_0, *history.compose(0, 1)) == Text{u"aBBc"});
+}
+
+TEST_CASE("PatchHistory::compose - random transactions") {
+  auto t = time(nullptr);
+  for (uint i = 0; i < 50; i++) {
+    uint32_t seed = t * 1000 + i;
+    Generator rand(seed);
+    cout << "seed: " << seed << "\n";
+
+    vector<Text> texts{Text{get_random_string_without_cr(rand, 50)}};
+    PatchHistory history;
+
+    for (uint j = 0, n = 1 + rand() % 40; j < n; j++) {
+      Text text = texts.back();
+      Patch patch;
+      for (uint k = 0, m = 1 + rand() % 3; k < m; k++) {
+        Range deleted_range = get_random_range(rand, text);
+        Text deleted_text{TextSlice(text).slice(deleted_range)};
+        Text inserted_text{get_random_string_without_cr(rand, 3)};
+        Point inserted_extent = inserted_text.extent();
+        text.splice(deleted_range.start, deleted_range.extent(), inserted_text);
+        REQUIRE(patch.splice(
+          deleted_range.start,
+          deleted_range.extent(),
+          inserted_extent,
+          move(deleted_text),
+          move(inserted_text)
+        ));
+      }
+      REQUIRE(history.push(move(patch)));
+      texts.push_back(move(text));
+
+      if (rand() % 10 == 0) {
+        uint32_t checkpoint = rand() % (history.size() + 1);
+        history.truncate(checkpoint);
+        texts.resize(checkpoint + 1);
+      }
+    }
+
+    REQUIRE(history.size() == texts.size() - 1);
+    for (uint j = 0; j + 1 < texts.size(); j++) {
+      REQUIRE(apply_patch(texts[j], *history.compose(j, j + 1)) == texts[j + 1]);
+    }
+    for (uint j = 0; j < 20; j++) {
+      uint32_t start = rand() % texts.size();
+      uint32_t end = rand() % texts.size();
+      auto patch = history.compose(start, end);
+      REQUIRE(static_cast<bool>(patch));
+      REQUIRE(apply_patch(texts[start], *patch) == texts[end]);
+    }
+  }
+}
@@ -259,6 +259,32 @@ TEST_CASE("Patch::find_changes_in_new_range") {
   }));
 }
 
+TEST_CASE("Patch::translate_old_to_new and translate_new_to_old") {
+  Patch patch;
+
+  patch.splice(Point{0, 5}, Point{0, 3}, Point{0, 4});
+  patch.splice(Point{0, 10}, Point{0, 3}, Point{0, 4});
+  patch.splice(Point{0, 2}, Point{0, 2}, Point{0, 1});
+  patch.splice(Point{0, 0}, Point{0, 0}, Point{0, 10});
+
+  REQUIRE(patch.translate_old_to_new({
+    Point{0, 0}, Point{0, 1}, Point{0, 2}, Point{0, 3}, Point{0, 4},
+    Point{0, 8}, Point{0, 13}, Point{1, 0}
+  }) == vector<Point>({
+    Point{0, 10}, Point{0, 11}, Point{0, 12}, Point{0, 13}, Point{0, 13},
+    Point{0, 18}, Point{0, 24}, Point{1, 0}
+  }));
+
+  REQUIRE(patch.translate_new_to_old({
+    Point{0, 24}, Point{0, 15}, Point{0, 12}, Point{0, 10}, Point{0, 5}, Point{0, 0}
+  }) == vector<Point>({
+    Point{0, 13}, Point{0, 8}, Point{0, 2}, Point{0, 0}, Point{0, 0}, Point{0, 0}
+  }));
+
+  REQUIRE(Patch().translate_old_to_new({Point{3, 4}}) == vector<Point>({Point{3, 4}}));
+  REQUIRE(patch.translate_old_to_new({}) == vector<Point>());
+}
+
 TEST_CASE("Patch::serialize") {
   Patch patch;
 
@@ -0,0 +1,99 @@
+#include "test-helpers.h"
+#include "run_set.h"
+#include <set>
+
+using std::set;
+using std::vector;
+
+template <typename T>
+static vector<T> to_vector(const run_set<T> &values) {
+  return vector<T>(values.begin(), values.end());
+}
+
+template <typename T>
+static vector<T> to_vector(const set<T> &values) {
+  return vector<T>(values.begin(), values.end());
+}
+
+TEST_CASE("run_set - inserting and erasing values") {
+  run_set<unsigned> values;
+  for (unsigned value : {5, 3, 4, 9, 10, 8}) values.insert(value);
+  REQUIRE(to_vector(values) == vector<unsigned>({3, 4, 5, 8, 9, 10}));
+  REQUIRE(values.size() == 6);
+  REQUIRE(values.run_count() == 2);
+
+  values.insert(6);
+  values.insert(7);
+  REQUIRE(values.run_count() == 1);
+  REQUIRE(values.count(7) == 1);
+  REQUIRE(values.count(11) == 0);
+
+  values.erase(6);
+  REQUIRE(to_vector(values) == vector<unsigned>({3, 4, 5, 7, 8, 9, 10}));
+  REQUIRE(values.run_count() == 2);
+
+  for (auto iter = values.begin(); iter != values.end();) {
+    if (*iter % 2 == 0) {
+      iter = values.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+  REQUIRE(to_vector(values) == vector<unsigned>({3, 5, 7, 9}));
+  REQUIRE(values.size() == 4);
+
+  values.insert(10);
+  vector<unsigned> copied_values(values.size());
+  values.copy_to(copied_values.data());
+  REQUIRE(copied_values == vector<unsigned>({3, 5, 7, 9, 10}));
+}
+
+TEST_CASE("run_set - set operations") {
+  for (uint32_t seed = 0; seed < 200; seed++) {
+    Generator rand(seed);
+    run_set<unsigned> a, b;
+    set<unsigned> expected_a, expected_b;
+    for (uint32_t i = 0, n = rand() % 60; i < n; i++) {
+      unsigned value = rand() % 80;
+      a.insert(value);
+      expected_a.insert(value);
+    }
+    for (uint32_t i = 0, n = rand() % 60; i < n; i++) {
+      unsigned value = rand() % 80;
+      b.insert(value);
+      expected_b.insert(value);
+    }
+
+    set<unsigned> expected_intersection;
+    for (unsigned value : expected_a) {
+      if (expected_b.count(value)) expected_intersection.insert(value);
+    }
+    run_set<unsigned> intersection = a.intersection(b);
+    REQUIRE(to_vector(intersection) == to_vector(expected_intersection));
+    REQUIRE(intersection.size() == expected_intersection.size());
+
+    run_set<unsigned> difference = a;
+    difference.erase(b);
+    set<unsigned> expected_difference;
+    for (unsigned value : expected_a) {
+      if (!expected_b.count(value)) expected_difference.insert(value);
+    }
+    REQUIRE(to_vector(difference) == to_vector(expected_difference));
+    REQUIRE(difference.size() == expected_difference.size());
+
+    run_set<unsigned> union_ = a;
+    union_.insert(b);
+    set<unsigned> expected_union = expected_a;
+    expected_union.insert(expected_b.begin(), expected_b.end());
+    REQUIRE(to_vector(union_) == to_vector(expected_union));
+    REQUIRE(union_.size() == expected_union.size());
+
+    run_set<unsigned> small_union = union_;
+    run_set<unsigned> single_value;
+    single_value.insert(rand() % 80);
+    small_union.insert(single_value);
+    expected_union.insert(*single_value.begin());
+    REQUIRE(to_vector(small_union) == to_vector(expected_union));
+    REQUIRE(small_union.size() == expected_union.size());
+  }
+}
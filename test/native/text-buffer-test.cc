@@ -3,6 +3,7 @@
 #include "text-buffer.h"
 #include "text-slice.h"
 #include "regex.h"
+#include "word-index.h"
 #include <future>
 #include <unistd.h>
 
@@ -48,6 +49,27 @@ TEST_CASE("TextBuffer::position_for_offset") {
   REQUIRE(buffer.position_for_offset(8) == Point(1, 4));
   REQUIRE(buffer.position_for_offset(9) == Point(1, 4));
   REQUIRE(buffer.position_for_offset(10) == Point(2, 0));
+
+  // Edits that move the start of a change after it has been looked up.
+  buffer.set_text_in_range({{1, 0}, {1, 1}}, u"");
+  buffer.set_text_in_range({{0, 1}, {0, 1}}, u"\n");
+  REQUIRE(buffer.text() == u"a\nbc\nefg\r\nhijk");
+  REQUIRE(buffer.position_for_offset(2) == Point(1, 0));
+  REQUIRE(buffer.position_for_offset(5) == Point(2, 0));
+  REQUIRE(buffer.position_for_offset(8) == Point(2, 3));
+  REQUIRE(buffer.position_for_offset(10) == Point(3, 0));
+
+  // Lookups in a layer above a snapshot.
+  TextBuffer::Snapshot *snapshot = buffer.create_snapshot();
+  buffer.set_text_in_range({{3, 1}, {3, 3}}, u"");
+  buffer.set_text_in_range({{0, 0}, {0, 0}}, u"xy");
+  REQUIRE(buffer.text() == u"xya\nbc\nefg\r\nhk");
+  REQUIRE(buffer.position_for_offset(4) == Point(1, 0));
+  REQUIRE(buffer.position_for_offset(10) == Point(2, 3));
+  REQUIRE(buffer.position_for_offset(11) == Point(2, 3));
+  REQUIRE(buffer.position_for_offset(12) == Point(3, 0));
+  REQUIRE(buffer.position_for_offset(13) == Point(3, 1));
+  delete snapshot;
 }
 
 TEST_CASE("TextBuffer::create_snapshot") {
@@ -299,6 +321,50 @@ TEST_CASE("Snapshot::flush_preceding_changes") {
   }
 }
 
+TEST_CASE("TextBuffer::serialize_changes - streaming") {
+  TextBuffer buffer{u"abc\ndef"};
+  buffer.set_text_in_range({{0, 1}, {0, 2}}, u"BBBBBBBBBBBBBBBBBBBB");
+  auto snapshot = buffer.create_snapshot();
+  buffer.set_text_in_range({{1, 0}, {1, 1}}, u"\nD\n");
+
+  vector<uint8_t> expected_bytes;
+  Serializer serializer(expected_bytes);
+  buffer.serialize_changes(serializer);
+
+  vector<uint8_t> bytes;
+  vector<uint8_t> chunk;
+  size_t write_count = 0;
+  Serializer streaming_serializer(chunk, [&](const uint8_t *data, size_t size) {
+    REQUIRE(size <= 7);
+    bytes.insert(bytes.end(), data, data + size);
+    write_count++;
+    return true;
+  }, 7);
+  snapshot->serialize_changes(streaming_serializer);
+  delete snapshot;
+  buffer.serialize_changes(streaming_serializer);
+  REQUIRE(streaming_serializer.flush());
+  REQUIRE(write_count > 1);
+
+  size_t read_offset = 0;
+  Deserializer deserializer([&](uint8_t *data, size_t size) {
+    size = std::min<size_t>(size, std::min<size_t>(3, bytes.size() - read_offset));
+    memcpy(data, bytes.data() + read_offset, size);
+    read_offset += size;
+    return size;
+  }, 5);
+
+  TextBuffer snapshot_copy{buffer.base_text().content};
+  REQUIRE(snapshot_copy.deserialize_changes(deserializer));
+  REQUIRE(snapshot_copy.text() == u"aBBBBBBBBBBBBBBBBBBBBc\ndef");
+
+  TextBuffer copy{buffer.base_text().content};
+  REQUIRE(copy.deserialize_changes(deserializer));
+  REQUIRE(copy.text() == buffer.text());
+  REQUIRE(read_offset == bytes.size());
+  REQUIRE(vector<uint8_t>(bytes.end() - expected_bytes.size(), bytes.end()) == expected_bytes);
+}
+
 TEST_CASE("TextBuffer::reset") {
   TextBuffer buffer{u"abcdef"};
   auto snapshot1 = buffer.create_snapshot();
@@ -379,6 +445,40 @@ TEST_CASE("TextBuffer::find - partial matches at EOF") {
   REQUIRE(*buffer.find(Regex(u"[^\r]\n", nullptr)) == *optional<Range>());
 }
 
+TEST_CASE("TextBuffer::find - literal patterns") {
+  TextBuffer buffer{u"a.b (A.B)\r\nab*"};
+  REQUIRE(*buffer.find(Regex(u"A\\.B", nullptr)) == (Range{{0, 5}, {0, 8}}));
+  REQUIRE(*buffer.find(Regex(u"A\\.B", nullptr, true)) == (Range{{0, 0}, {0, 3}}));
+  REQUIRE(*buffer.find(Regex(u"\\(a.b\\)", nullptr, true)) == (Range{{0, 4}, {0, 9}}));
+  REQUIRE(*buffer.find(Regex(u"\\)\r\nA", nullptr, true)) == (Range{{0, 8}, {1, 1}}));
+  REQUIRE(*buffer.find(Regex::literal(u")\r\nA", true)) == (Range{{0, 8}, {1, 1}}));
+  REQUIRE(*buffer.find(Regex::literal(u"b*")) == (Range{{1, 1}, {1, 3}}));
+  REQUIRE(*buffer.find(Regex::literal(u"b**")) == *optional<Range>{});
+
+  // Literal patterns match the same ranges as the equivalent PCRE patterns,
+  // including across the chunks of edited buffers.
+  for (uint32_t seed = 0; seed < 100; seed++) {
+    Generator rand(seed);
+    TextBuffer buffer{get_random_string(rand, 30)};
+    for (uint32_t i = 0; i < 5; i++) {
+      buffer.set_text_in_range(get_random_range(rand, buffer), get_random_string(rand, 5));
+    }
+
+    u16string text = buffer.text();
+    size_t start = rand() % text.size();
+    u16string pattern = text.substr(start, 1 + rand() % 3);
+    bool ignore_case = rand() % 2;
+    if (ignore_case) {
+      std::transform(pattern.begin(), pattern.end(), pattern.begin(), towupper);
+    }
+
+    Regex literal_regex(pattern, nullptr, ignore_case);
+    Regex pcre_regex(u"(?:" + pattern + u")", nullptr, ignore_case);
+    REQUIRE(buffer.find_all(literal_regex) == buffer.find_all(pcre_regex));
+    REQUIRE(buffer.find_all(Regex::literal(pattern, ignore_case)) == buffer.find_all(pcre_regex));
+  }
+}
+
 TEST_CASE("TextBuffer::find_all") {
   TextBuffer buffer{u"abc\ndefg\nhijkl"};
   REQUIRE(buffer.find_all(Regex(u"\\w+", nullptr)) == vector<Range>({
@@ -427,6 +527,183 @@ TEST_CASE("TextBuffer::find_all - empty matches") {
   }));
 }
 
+TEST_CASE("TextBuffer::find_each") {
+  TextBuffer buffer{u"abc\ndefg\nhijkl"};
+  buffer.set_text_in_range({{1, 2}, {1, 2}}, u"12");
+
+  vector<Range> matches;
+  buffer.find_each(Regex(u"\\w+", nullptr), [&matches](Range match) {
+    matches.push_back(match);
+    return false;
+  });
+  REQUIRE(matches == buffer.find_all(Regex(u"\\w+", nullptr)));
+
+  matches.clear();
+  TextBuffer::Snapshot *snapshot = buffer.create_snapshot();
+  buffer.set_text(u"");
+  snapshot->find_each(Regex(u"\\w", nullptr), [&matches](Range match) {
+    matches.push_back(match);
+    return matches.size() == 2;
+  }, {{1, 0}, {2, 0}});
+  REQUIRE(matches == vector<Range>({
+    Range{Point{1, 0}, Point{1, 1}},
+    Range{Point{1, 1}, Point{1, 2}},
+  }));
+  delete snapshot;
+}
+
+TEST_CASE("TextBuffer::find_each_prioritized") {
+  TextBuffer buffer{u"ab\ncd\nef\ngh\nij"};
+  buffer.set_text_in_range({{2, 1}, {2, 1}}, u"x");
+  Regex regex(u"\\w", nullptr);
+
+  vector<Range> matches;
+  vector<size_t> part_ends;
+  auto add_match = [&matches](Range match) {
+    matches.push_back(match);
+    return false;
+  };
+  auto end_part = [&matches, &part_ends]() { part_ends.push_back(matches.size()); };
+
+  // The priority rows come first, then the rows below them, then the rows
+  // above them.
+  buffer.find_each_prioritized(regex, {{2, 1}, {3, 0}}, add_match, end_part);
+  REQUIRE(matches == vector<Range>({
+    Range{Point{2, 0}, Point{2, 1}},
+    Range{Point{2, 1}, Point{2, 2}},
+    Range{Point{2, 2}, Point{2, 3}},
+    Range{Point{3, 0}, Point{3, 1}},
+    Range{Point{3, 1}, Point{3, 2}},
+    Range{Point{4, 0}, Point{4, 1}},
+    Range{Point{4, 1}, Point{4, 2}},
+    Range{Point{0, 0}, Point{0, 1}},
+    Range{Point{0, 1}, Point{0, 2}},
+    Range{Point{1, 0}, Point{1, 1}},
+    Range{Point{1, 1}, Point{1, 2}},
+  }));
+  REQUIRE(part_ends == vector<size_t>({5, 7, 11}));
+
+  // The search stops as soon as the callback returns true, and stays within
+  // the given range.
+  matches.clear();
+  part_ends.clear();
+  buffer.find_each_prioritized(regex, {{3, 0}, {3, 0}}, [&matches](Range match) {
+    matches.push_back(match);
+    return matches.size() == 3;
+  }, end_part, {{1, 1}, {4, 1}});
+  REQUIRE(matches == vector<Range>({
+    Range{Point{3, 0}, Point{3, 1}},
+    Range{Point{3, 1}, Point{3, 2}},
+    Range{Point{4, 0}, Point{4, 1}},
+  }));
+
+  // Patterns that don't match line breaks find the same matches as a
+  // search of the whole range.
+  const char16_t *regex_sources[] = {u"\\w+", u"^", u"$", u"a*", u"[a-c]$"};
+  for (uint32_t seed = 0; seed < 100; seed++) {
+    Generator rand(seed);
+    TextBuffer buffer{get_random_string(rand, 50)};
+    for (uint32_t i = 0; i < 5; i++) {
+      buffer.set_text_in_range(get_random_range(rand, buffer), get_random_string(rand, 10));
+    }
+
+    Regex regex(regex_sources[rand() % 5], nullptr);
+    Range range = get_random_range(rand, buffer);
+    Range priority_range = get_random_range(rand, buffer);
+    vector<Range> matches;
+    buffer.find_each_prioritized(regex, priority_range, [&matches](Range match) {
+      matches.push_back(match);
+      return false;
+    }, []() {}, range);
+
+    std::sort(matches.begin(), matches.end(), [](Range a, Range b) { return a.start < b.start; });
+    REQUIRE(matches == buffer.find_all(regex, range));
+  }
+}
+
+TEST_CASE("TextBuffer::find_all_multi") {
+  using PatternMatch = TextBuffer::PatternMatch;
+
+  TextBuffer buffer{u"// TDO: fix this\nlet x = 1 // FixMe\n"};
+  buffer.set_text_in_range({{1, 3}, {1, 3}}, u" y");
+  buffer.set_text_in_range({{0, 4}, {0, 4}}, u"O");
+  REQUIRE(buffer.text() == u"// TODO: fix this\nlet y x = 1 // FixMe\n");
+
+  Regex regex({
+    {u"TODO", true, false},
+    {u"fixme", true, true},
+    {u"\\b[xy]\\b", false, false},
+    {u"FIX\\w*", false, true},
+  }, nullptr);
+  REQUIRE(buffer.find_all_multi(regex) == vector<PatternMatch>({
+    PatternMatch{0, Range{Point{0, 3}, Point{0, 7}}},
+    PatternMatch{3, Range{Point{0, 9}, Point{0, 12}}},
+    PatternMatch{2, Range{Point{1, 4}, Point{1, 5}}},
+    PatternMatch{2, Range{Point{1, 6}, Point{1, 7}}},
+    PatternMatch{1, Range{Point{1, 15}, Point{1, 20}}},
+  }));
+  REQUIRE(buffer.find_all_multi(regex, {{0, 4}, {1, 5}}) == vector<PatternMatch>({
+    PatternMatch{3, Range{Point{0, 9}, Point{0, 12}}},
+    PatternMatch{2, Range{Point{1, 4}, Point{1, 5}}},
+  }));
+
+  // Where several patterns match at the same position, the first one wins.
+  REQUIRE(buffer.find_all_multi(Regex({{u"TO", true, false}, {u"TODO", true, false}}, nullptr)) == vector<PatternMatch>({
+    PatternMatch{0, Range{Point{0, 3}, Point{0, 5}}},
+  }));
+  REQUIRE(buffer.find_all_multi(Regex({{u"T\\w", false, false}, {u"TODO", true, false}}, nullptr)) == vector<PatternMatch>({
+    PatternMatch{0, Range{Point{0, 3}, Point{0, 5}}},
+  }));
+
+  u16string error_message;
+  Regex({{u"(", true, false}, {u"a)", false, false}}, &error_message);
+  REQUIRE(error_message == u"unmatched closing parenthesis");
+
+  // Searching for literals with the automaton finds the same matches as
+  // searching for all of the patterns with PCRE.
+  const char16_t *regex_sources[] = {u"[a-f]+", u"x\\w", u"b\\n?c", u"(?i)q"};
+  for (uint32_t seed = 0; seed < 100; seed++) {
+    Generator rand(seed);
+    TextBuffer buffer{get_random_string(rand, 100)};
+    for (uint32_t i = 0; i < 10; i++) {
+      buffer.set_text_in_range(get_random_range(rand, buffer), get_random_string(rand, 10));
+    }
+
+    u16string text = buffer.text();
+    vector<Regex::Pattern> patterns;
+    vector<Regex::Pattern> pcre_patterns;
+    for (uint32_t i = 0, count = 1 + rand() % 6; i < count; i++) {
+      if (rand() % 3 == 0) {
+        Regex::Pattern pattern{regex_sources[rand() % 4], false, bool(rand() % 2)};
+        patterns.push_back(pattern);
+        pcre_patterns.push_back(pattern);
+      } else {
+        u16string source = text.substr(rand() % text.size(), 1 + rand() % 4);
+        bool ignore_case = rand() % 2;
+        if (ignore_case) std::transform(source.begin(), source.end(), source.begin(), towupper);
+        patterns.push_back({source, true, ignore_case});
+        pcre_patterns.push_back({u"\\Q" + source + u"\\E", false, ignore_case});
+      }
+    }
+
+    REQUIRE(buffer.find_all_multi(Regex(patterns, nullptr)) == buffer.find_all_multi(Regex(pcre_patterns, nullptr)));
+  }
+
+  // A match at the end of a line is found when the copy of the text around a
+  // chunk boundary ends right before the line ending.
+  uint32_t max_chunk_size_to_copy = TextBuffer::MAX_CHUNK_SIZE_TO_COPY;
+  TextBuffer::MAX_CHUNK_SIZE_TO_COPY = 8;
+  for (uint32_t length = 4; length < 10; length++) {
+    TextBuffer buffer{u16string(length, '.') + u"A\r\nnext"};
+    buffer.set_text_in_range({{0, 0}, {0, 0}}, u"B");
+    Regex regex({{u"b\nb", true, false}, {u"a$", false, true}}, nullptr);
+    REQUIRE(buffer.find_all_multi(regex) == vector<PatternMatch>({
+      PatternMatch{1, Range{Point{0, length + 1}, Point{0, length + 2}}},
+    }));
+  }
+  TextBuffer::MAX_CHUNK_SIZE_TO_COPY = max_chunk_size_to_copy;
+}
+
 TEST_CASE("TextBuffer::find_words_with_subsequence_in_range") {
   {
     TextBuffer buffer{u"banana band bandana banana"};
@@ -465,6 +742,119 @@ TEST_CASE("TextBuffer::find_words_with_subsequence_in_range") {
   }
 }
 
+TEST_CASE("TextBuffer::find_words_with_subsequence_in_range - after edits") {
+  TextBuffer buffer{u"banana band\nbandana\r\nbanana"};
+  Range all{Point{0, 0}, Point::max()};
+  REQUIRE(buffer.find_words_with_subsequence_in_range(u"bna", u"", all) == vector<SubsequenceMatch>({
+    {u"banana", {Point{0, 0}, Point{2, 0}}, {0, 2, 3}, 12},
+    {u"bandana", {Point{1, 0}}, {0, 5, 6}, 7}
+  }));
+
+  buffer.set_text_in_range({{0, 7}, {1, 0}}, u"bonanza\nbnb\n");
+  REQUIRE(buffer.text() == u"banana bonanza\nbnb\nbandana\r\nbanana");
+  REQUIRE(buffer.find_words_with_subsequence_in_range(u"bna", u"", all) == vector<SubsequenceMatch>({
+    {u"banana", {Point{0, 0}, Point{3, 0}}, {0, 2, 3}, 12},
+    {u"bonanza", {Point{0, 7}}, {0, 2, 3}, 12},
+    {u"bandana", {Point{2, 0}}, {0, 5, 6}, 7}
+  }));
+
+  // Positions are relative to the start of the buffer, and words are cut off
+  // at the edges of the range.
+  REQUIRE(buffer.find_words_with_subsequence_in_range(u"ban", u"", Range{Point{0, 1}, Point{2, 5}}) == vector<SubsequenceMatch>({
+    {u"banda", {Point{2, 0}}, {0, 1, 2}, 20},
+    {u"bonanza", {Point{0, 7}}, {0, 3, 4}, 9}
+  }));
+
+  auto snapshot = buffer.create_snapshot();
+  buffer.set_text_in_range({{0, 0}, {0, 7}}, u"");
+  REQUIRE(snapshot->find_words_with_subsequence_in_range(u"bonz", u"", all) == vector<SubsequenceMatch>({
+    {u"bonanza", {Point{0, 7}}, {0, 1, 2, 5}, 18}
+  }));
+  REQUIRE(buffer.find_words_with_subsequence_in_range(u"bonz", u"", all) == vector<SubsequenceMatch>({
+    {u"bonanza", {Point{0, 0}}, {0, 1, 2, 5}, 18}
+  }));
+  delete snapshot;
+
+  for (uint32_t seed = 0; seed < 20; seed++) {
+    Generator rand(seed);
+    TextBuffer buffer{get_random_text(rand).content};
+    buffer.find_words_with_subsequence_in_range(u"a", u"_", all);
+    for (uint32_t i = 0; i < 10; i++) {
+      Range deleted_range = get_random_range(rand, buffer);
+      buffer.set_text_in_range(deleted_range, get_random_text(rand).content);
+      Range range = get_random_range(rand, buffer);
+      TextBuffer expected_buffer{buffer.text()};
+      u16string query = get_random_string(rand, 2);
+      REQUIRE(
+        buffer.find_words_with_subsequence_in_range(query, u"_", range) ==
+        expected_buffer.find_words_with_subsequence_in_range(query, u"_", range)
+      );
+    }
+  }
+}
+
+TEST_CASE("TextBuffer::find_words_with_subsequence_in_range - case folding") {
+  Range all{Point{0, 0}, Point::max()};
+  TextBuffer buffer{u"FooBar foobar FOO"};
+  buffer.find_words_with_subsequence_in_range(u"x", u"", all);
+  buffer.set_text_in_range({{0, 14}, {0, 17}}, u"FOOBAR");
+  REQUIRE(buffer.find_words_with_subsequence_in_range(u"fB", u"", all) == vector<SubsequenceMatch>({
+    {u"FooBar", {Point{0, 0}}, {0, 3}, 13},
+    {u"foobar", {Point{0, 7}}, {0, 3}, 4},
+    {u"FOOBAR", {Point{0, 14}}, {0, 3}, 3},
+  }));
+
+  // Replacing every word leaves the index with more removed words than live
+  // ones, which it then compacts.
+  for (uint32_t i = 0; i < 20; i++) {
+    u16string text;
+    for (uint32_t j = 0; j < 50; j++) {
+      text += u"Word" + u16string(1, u'a' + (i + j) % 26) + u16string(i % 5, u'x') + u" ";
+    }
+    buffer.set_text(u16string(text));
+    REQUIRE(
+      buffer.find_words_with_subsequence_in_range(u"wdx", u"", all) ==
+      TextBuffer{text}.find_words_with_subsequence_in_range(u"wdx", u"", all)
+    );
+  }
+}
+
+TEST_CASE("TextBuffer::find_words_with_subsequence_in_range - max count") {
+  Range all{Point{0, 0}, Point::max()};
+  TextBuffer buffer{u"banana band\nbandana bonanza"};
+  REQUIRE(buffer.find_words_with_subsequence_in_range(u"bna", u"", all, 2) == vector<SubsequenceMatch>({
+    {u"banana", {Point{0, 0}}, {0, 2, 3}, 12},
+    {u"bonanza", {Point{1, 8}}, {0, 2, 3}, 12},
+  }));
+  REQUIRE(buffer.find_words_with_subsequence_in_range(u"bna", u"", all, 0).empty());
+
+  for (uint32_t seed = 0; seed < 50; seed++) {
+    Generator rand(seed);
+    u16string text;
+    for (uint32_t i = 0; i < 200; i++) {
+      uint32_t length = 1 + rand() % 12;
+      for (uint32_t j = 0; j < length; j++) {
+        char16_t c = 'a' + rand() % 6;
+        text.push_back(rand() % 4 == 0 ? towupper(c) : c);
+      }
+      text.push_back(u" _\n"[rand() % 3]);
+    }
+
+    TextBuffer buffer{text};
+    u16string query = get_random_string(rand, 1 + rand() % 3);
+    auto all_matches = buffer.find_words_with_subsequence_in_range(query, u"_", all);
+    for (const SubsequenceMatch &match : all_matches) {
+      u16string lowercase_query = query;
+      std::transform(lowercase_query.begin(), lowercase_query.end(), lowercase_query.begin(), towlower);
+      REQUIRE(WordIndex::max_match_score(match.word, lowercase_query) >= match.score);
+    }
+
+    size_t max_count = rand() % 10;
+    if (all_matches.size() > max_count) all_matches.resize(max_count);
+    REQUIRE(buffer.find_words_with_subsequence_in_range(query, u"_", all, max_count) == all_matches);
+  }
+}
+
 TEST_CASE("TextBuffer::has_astral") {
   REQUIRE(TextBuffer{u"ab" "\xd83d" "\xde01" "cd"}.has_astral());
   REQUIRE(!TextBuffer{u"abcd"}.has_astral());
@@ -108,3 +108,25 @@ TEST_CASE("Text::offset_for_position - empty lines") {
   REQUIRE(text.offset_for_position({1, UINT32_MAX}) == 2);
   REQUIRE(slice.position_for_offset(2) == Point(1, 0));
 }
+
+TEST_CASE("Text::serialize") {
+  Text text {u"abc\ndef\r\nghi\n"};
+
+  std::vector<uint8_t> bytes;
+  Serializer serializer(bytes);
+  text.serialize(serializer);
+  Text().serialize(serializer);
+
+  Deserializer deserializer(bytes.data(), bytes.size());
+  Text text_copy(deserializer);
+  REQUIRE(text_copy == text);
+  REQUIRE(text_copy.extent() == text.extent());
+  REQUIRE(Text(deserializer) == Text());
+  REQUIRE(deserializer.remaining() == 0);
+
+  Deserializer truncated_deserializer(bytes.data(), 8);
+  Text truncated_copy(truncated_deserializer);
+  REQUIRE(truncated_copy.size() == 13);
+  REQUIRE(truncated_copy.content.substr(0, 3) == std::u16string(u"ab\0", 3));
+  REQUIRE(truncated_deserializer.remaining() == 0);
+}
@@ -0,0 +1,89 @@
+#include "test-helpers.h"
+#include "word-corpus.h"
+#include <map>
+#include <memory>
+
+using std::map;
+using std::u16string;
+using std::vector;
+using Match = WordCorpus::Match;
+using SubsequenceMatch = TextBuffer::SubsequenceMatch;
+
+TEST_CASE("WordCorpus::find_words_with_subsequence - merging buffers") {
+  TextBuffer buffer1{u"banana band\nbandana"};
+  TextBuffer buffer2{u"bonanza\nbanana"};
+  WordCorpus corpus;
+  auto id1 = corpus.add_buffer(&buffer1);
+  auto id2 = corpus.add_buffer(&buffer2);
+  REQUIRE(corpus.add_buffer(&buffer1) == id1);
+  REQUIRE(corpus.buffer_count() == 2);
+
+  REQUIRE(corpus.find_words_with_subsequence(u"bna", u"", 10) == vector<Match>({
+    {u"banana", {{id1, {Point{0, 0}}}, {id2, {Point{1, 0}}}}, {0, 2, 3}, 12},
+    {u"bonanza", {{id2, {Point{0, 0}}}}, {0, 2, 3}, 12},
+    {u"bandana", {{id1, {Point{1, 0}}}}, {0, 5, 6}, 7}
+  }));
+
+  REQUIRE(corpus.find_words_with_subsequence(u"bna", u"", 1) == vector<Match>({
+    {u"banana", {{id1, {Point{0, 0}}}, {id2, {Point{1, 0}}}}, {0, 2, 3}, 12},
+  }));
+
+  // Queries on a snapshot don't see later edits, and the word indices they
+  // build are handed back to the buffers.
+  auto snapshot = corpus.create_snapshot();
+  buffer2.set_text(u"bnb");
+  REQUIRE(snapshot->find_words_with_subsequence(u"bnz", u"", 10) == vector<Match>({
+    {u"bonanza", {{id2, {Point{0, 0}}}}, {0, 4, 5}, 8}
+  }));
+  delete snapshot;
+
+  REQUIRE(corpus.remove_buffer(id1));
+  REQUIRE(!corpus.remove_buffer(id1));
+  REQUIRE(corpus.find_words_with_subsequence(u"bnb", u"", 10) == vector<Match>({
+    {u"bnb", {{id2, {Point{0, 0}}}}, {0, 1, 2}, 20}
+  }));
+}
+
+TEST_CASE("WordCorpus::find_words_with_subsequence - random buffers") {
+  for (uint32_t seed = 0; seed < 20; seed++) {
+    Generator rand(seed);
+    vector<std::unique_ptr<TextBuffer>> buffers;
+    for (uint32_t i = 0; i < 4; i++) {
+      buffers.emplace_back(new TextBuffer{get_random_text(rand).content});
+    }
+
+    WordCorpus corpus;
+    vector<WordCorpus::BufferId> ids;
+    for (auto &buffer : buffers) {
+      ids.push_back(corpus.add_buffer(buffer.get()));
+    }
+
+    for (uint32_t i = 0; i < 5; i++) {
+      TextBuffer &buffer = *buffers[rand() % buffers.size()];
+      buffer.set_text_in_range(get_random_range(rand, buffer), get_random_text(rand).content);
+
+      // Score each buffer's words separately, and merge the results by word.
+      u16string query = get_random_string(rand, 1);
+      map<u16string, Match> expected_matches;
+      for (size_t j = 0; j < buffers.size(); j++) {
+        for (const SubsequenceMatch &match : buffers[j]->find_words_with_subsequence_in_range(query, u"_", Range::all_inclusive())) {
+          Match &expected_match = expected_matches[match.word];
+          expected_match.word = match.word;
+          expected_match.positions.push_back({ids[j], match.positions});
+          expected_match.match_indices = match.match_indices;
+          expected_match.score = match.score;
+        }
+      }
+
+      vector<Match> expected;
+      for (auto &entry : expected_matches) expected.push_back(entry.second);
+      std::stable_sort(expected.begin(), expected.end(), [] (const Match &a, const Match &b) {
+        return a.score > b.score;
+      });
+      if (expected.size() > 5) expected.resize(5);
+
+      REQUIRE(corpus.find_words_with_subsequence(query, u"_", 5, 1) == expected);
+      REQUIRE(corpus.find_words_with_subsequence(query, u"_", 5, 4) == expected);
+    }
+  }
+}